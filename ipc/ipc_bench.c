@@ -0,0 +1,715 @@
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <semaphore.h>
+#include <time.h>
+
+#include "transform_pool.h"
+
+// Runs the laba1/laba3 workload (route each line to one of two consumers,
+// strip vowels there) over several transports with identical framing, so
+// the numbers differ only in how bytes cross the process boundary. The
+// `threads` transport runs the same workload in one process on a
+// transform pool instead.
+
+#define CONSUMERS 2
+#define RING_SIZE (1u << 20)
+#define SEQPACKET_MAX (64 * 1024)
+#define FRAME_END UINT32_MAX
+
+typedef struct {
+    uint32_t len;
+    uint32_t seq;
+    uint64_t stamp;
+} FrameHeader;
+
+typedef enum {
+    TRANSPORT_PIPE,
+    TRANSPORT_SHM_SEM,
+    TRANSPORT_SHM_RING,
+    TRANSPORT_UNIX_STREAM,
+    TRANSPORT_UNIX_SEQPACKET,
+    TRANSPORT_EVENTFD_RING,
+    TRANSPORT_THREADS,
+    TRANSPORT_COUNT
+} Transport;
+
+static const char *const transport_names[TRANSPORT_COUNT] = {
+    "pipe", "shm_sem", "shm_ring", "unix_stream", "unix_seqpacket", "eventfd_ring", "threads"
+};
+
+typedef struct {
+    sem_t full;
+    sem_t empty;
+    size_t len;
+    char data[];
+} ShmSlot;
+
+typedef struct {
+    _Alignas(64) uint64_t head;
+    _Alignas(64) uint64_t tail;
+    _Alignas(64) char data[RING_SIZE];
+} ShmRing;
+
+typedef struct {
+    Transport transport;
+    int fds[2];          // [0] consumer end, [1] producer end
+    int data_efd;
+    int space_efd;
+    ShmSlot *slot;
+    size_t slot_size;
+    ShmRing *ring;
+    size_t max_send;
+} Channel;
+
+typedef struct {
+    uint64_t count;
+    uint64_t checksum;
+} ConsumerResult;
+
+typedef struct {
+    size_t messages;
+    size_t message_size;
+    size_t batch;
+    int workers;
+} Workload;
+
+typedef struct {
+    size_t message_size;
+    ConsumerResult results[CONSUMERS];
+    uint64_t *latencies[CONSUMERS];
+} PoolRun;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t rusage_ns(const struct rusage *ru) {
+    return (uint64_t)(ru->ru_utime.tv_sec + ru->ru_stime.tv_sec) * 1000000000ull
+           + (uint64_t)(ru->ru_utime.tv_usec + ru->ru_stime.tv_usec) * 1000ull;
+}
+
+static void die(const char *what) {
+    perror(what);
+    exit(EXIT_FAILURE);
+}
+
+static void delete_vowels(char *str, size_t len) {
+    const char *vowels = "AEIOUYaeiouy";
+    size_t j = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (!memchr(vowels, str[i], 12)) {
+            str[j++] = str[i];
+        }
+    }
+    str[j] = '\0';
+}
+
+static uint64_t fnv1a(uint64_t hash, const char *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t lcg_next(uint64_t *state) {
+    *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+    return *state >> 33;
+}
+
+// Deterministic message `index`: length in [1, size], lowercase/uppercase text.
+static size_t make_message(char *out, size_t size, uint64_t index) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ ";
+    uint64_t state = index * 0x9E3779B97F4A7C15ull + 1;
+    size_t len = 1 + lcg_next(&state) % size;
+    for (size_t i = 0; i < len; i++) {
+        out[i] = alphabet[lcg_next(&state) % (sizeof(alphabet) - 1)];
+    }
+    return len;
+}
+
+// laba1/laba3 route lines longer than 10 characters to the first client;
+// the threshold scales with the configured message size here.
+static int route(size_t len, size_t size) {
+    size_t threshold = size > 20 ? size / 2 : 10;
+    return len > threshold ? 0 : 1;
+}
+
+static void *map_shared(size_t size) {
+    void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) die("mmap");
+    return memory;
+}
+
+static void channel_open(Channel *channel, Transport transport, size_t batch_bytes) {
+    memset(channel, 0, sizeof(*channel));
+    channel->transport = transport;
+    channel->fds[0] = channel->fds[1] = -1;
+    channel->data_efd = channel->space_efd = -1;
+    channel->max_send = batch_bytes;
+
+    switch (transport) {
+        case TRANSPORT_PIPE:
+            if (pipe(channel->fds) == -1) die("pipe");
+            break;
+
+        case TRANSPORT_UNIX_STREAM:
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, channel->fds) == -1) die("socketpair");
+            break;
+
+        case TRANSPORT_UNIX_SEQPACKET:
+            if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, channel->fds) == -1) die("socketpair");
+            if (channel->max_send > SEQPACKET_MAX) channel->max_send = SEQPACKET_MAX;
+            break;
+
+        case TRANSPORT_SHM_SEM:
+            channel->slot_size = sizeof(ShmSlot) + batch_bytes;
+            channel->slot = map_shared(channel->slot_size);
+            sem_init(&channel->slot->full, 1, 0);
+            sem_init(&channel->slot->empty, 1, 1);
+            break;
+
+        case TRANSPORT_EVENTFD_RING:
+            channel->data_efd = eventfd(0, 0);
+            channel->space_efd = eventfd(0, 0);
+            if (channel->data_efd == -1 || channel->space_efd == -1) die("eventfd");
+            // fall through
+        case TRANSPORT_SHM_RING:
+            channel->ring = map_shared(sizeof(ShmRing));
+            if (channel->max_send > RING_SIZE / 2) channel->max_send = RING_SIZE / 2;
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void channel_close(Channel *channel) {
+    for (int i = 0; i < 2; i++) {
+        if (channel->fds[i] != -1) close(channel->fds[i]);
+    }
+    if (channel->data_efd != -1) close(channel->data_efd);
+    if (channel->space_efd != -1) close(channel->space_efd);
+    if (channel->slot) {
+        sem_destroy(&channel->slot->full);
+        sem_destroy(&channel->slot->empty);
+        munmap(channel->slot, channel->slot_size);
+    }
+    if (channel->ring) munmap(channel->ring, sizeof(ShmRing));
+}
+
+static void efd_wait(int efd) {
+    uint64_t value;
+    while (read(efd, &value, sizeof(value)) == -1) {
+        if (errno != EINTR) die("read eventfd");
+    }
+}
+
+static void efd_signal(int efd) {
+    uint64_t value = 1;
+    if (write(efd, &value, sizeof(value)) == -1) die("write eventfd");
+}
+
+static void write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written == -1) {
+            if (errno == EINTR) continue;
+            die("write");
+        }
+        data += written;
+        len -= (size_t)written;
+    }
+}
+
+static void ring_put(Channel *channel, const char *data, size_t len) {
+    ShmRing *ring = channel->ring;
+    uint64_t tail = ring->tail;
+
+    while (RING_SIZE - (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) < len) {
+        if (channel->transport == TRANSPORT_EVENTFD_RING) efd_wait(channel->space_efd);
+        else sched_yield();
+    }
+
+    size_t offset = tail & (RING_SIZE - 1);
+    size_t first = len < RING_SIZE - offset ? len : RING_SIZE - offset;
+    memcpy(ring->data + offset, data, first);
+    memcpy(ring->data, data + first, len - first);
+    __atomic_store_n(&ring->tail, tail + len, __ATOMIC_RELEASE);
+
+    if (channel->transport == TRANSPORT_EVENTFD_RING) efd_signal(channel->data_efd);
+}
+
+static size_t ring_get(Channel *channel, char *out, size_t cap) {
+    ShmRing *ring = channel->ring;
+    uint64_t head = ring->head;
+    uint64_t tail;
+
+    while ((tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) == head) {
+        if (channel->transport == TRANSPORT_EVENTFD_RING) efd_wait(channel->data_efd);
+        else sched_yield();
+    }
+
+    size_t len = tail - head;
+    if (len > cap) len = cap;
+    size_t offset = head & (RING_SIZE - 1);
+    size_t first = len < RING_SIZE - offset ? len : RING_SIZE - offset;
+    memcpy(out, ring->data + offset, first);
+    memcpy(out + first, ring->data, len - first);
+    __atomic_store_n(&ring->head, head + len, __ATOMIC_RELEASE);
+
+    if (channel->transport == TRANSPORT_EVENTFD_RING) efd_signal(channel->space_efd);
+    return len;
+}
+
+static void channel_send(Channel *channel, const char *data, size_t len) {
+    switch (channel->transport) {
+        case TRANSPORT_PIPE:
+        case TRANSPORT_UNIX_STREAM:
+            write_all(channel->fds[1], data, len);
+            break;
+
+        case TRANSPORT_UNIX_SEQPACKET:
+            while (send(channel->fds[1], data, len, 0) == -1) {
+                if (errno != EINTR) die("send");
+            }
+            break;
+
+        case TRANSPORT_SHM_SEM:
+            sem_wait(&channel->slot->empty);
+            memcpy(channel->slot->data, data, len);
+            channel->slot->len = len;
+            sem_post(&channel->slot->full);
+            break;
+
+        case TRANSPORT_SHM_RING:
+        case TRANSPORT_EVENTFD_RING:
+            ring_put(channel, data, len);
+            break;
+
+        default:
+            break;
+    }
+}
+
+static size_t channel_recv(Channel *channel, char *out, size_t cap) {
+    ssize_t got;
+
+    switch (channel->transport) {
+        case TRANSPORT_PIPE:
+        case TRANSPORT_UNIX_STREAM:
+        case TRANSPORT_UNIX_SEQPACKET:
+            while ((got = read(channel->fds[0], out, cap)) == -1) {
+                if (errno != EINTR) die("read");
+            }
+            return (size_t)got;
+
+        case TRANSPORT_SHM_SEM: {
+            sem_wait(&channel->slot->full);
+            size_t len = channel->slot->len;
+            memcpy(out, channel->slot->data, len);
+            sem_post(&channel->slot->empty);
+            return len;
+        }
+
+        case TRANSPORT_SHM_RING:
+        case TRANSPORT_EVENTFD_RING:
+            return ring_get(channel, out, cap);
+
+        default:
+            return 0;
+    }
+}
+
+static void consumer_run(Channel *channel, size_t recv_cap, ConsumerResult *result,
+                         uint64_t *latencies) {
+    char *buf = malloc(recv_cap);
+    if (!buf) die("malloc");
+
+    size_t have = 0;
+    uint64_t checksum = 1469598103934665603ull;
+    uint64_t count = 0;
+    bool done = false;
+
+    while (!done) {
+        // The last byte is never handed to the transport: it is where the
+        // payload ending the buffer gets NUL-terminated.
+        size_t got = channel_recv(channel, buf + have, recv_cap - 1 - have);
+        if (got == 0) break;
+        have += got;
+
+        size_t pos = 0;
+        while (have - pos >= sizeof(FrameHeader)) {
+            FrameHeader header;
+            memcpy(&header, buf + pos, sizeof(header));
+            if (header.len == FRAME_END) {
+                done = true;
+                break;
+            }
+            if (have - pos < sizeof(header) + header.len) break;
+
+            char *payload = buf + pos + sizeof(header);
+            char saved = payload[header.len];
+            delete_vowels(payload, header.len);
+            checksum = fnv1a(checksum, payload, strlen(payload));
+            payload[header.len] = saved;
+
+            latencies[count++] = now_ns() - header.stamp;
+            pos += sizeof(header) + header.len;
+        }
+
+        memmove(buf, buf + pos, have - pos);
+        have -= pos;
+    }
+
+    result->count = count;
+    result->checksum = checksum;
+    free(buf);
+}
+
+static uint64_t expected_checksum(const Workload *workload, int consumer) {
+    char *message = malloc(workload->message_size + 1);
+    if (!message) die("malloc");
+
+    uint64_t checksum = 1469598103934665603ull;
+    for (size_t i = 0; i < workload->messages; i++) {
+        size_t len = make_message(message, workload->message_size, i);
+        if (route(len, workload->message_size) != consumer) continue;
+        delete_vowels(message, len);
+        checksum = fnv1a(checksum, message, strlen(message));
+    }
+
+    free(message);
+    return checksum;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t percentile(const uint64_t *sorted, size_t count, double p) {
+    if (count == 0) return 0;
+    size_t index = (size_t)(p * (double)(count - 1) + 0.5);
+    return sorted[index];
+}
+
+static void report(const char *name, const Workload *workload, const ConsumerResult *results,
+                   uint64_t *const *latencies, uint64_t payload_bytes, uint64_t elapsed, uint64_t cpu) {
+    size_t total = 0;
+    bool valid = true;
+    for (int c = 0; c < CONSUMERS; c++) {
+        total += results[c].count;
+        if (results[c].checksum != expected_checksum(workload, c)) valid = false;
+    }
+    if (total != workload->messages) valid = false;
+
+    uint64_t *all = malloc(sizeof(uint64_t) * (total + 1));
+    if (!all) die("malloc");
+    memcpy(all, latencies[0], sizeof(uint64_t) * results[0].count);
+    memcpy(all + results[0].count, latencies[1], sizeof(uint64_t) * results[1].count);
+    qsort(all, total, sizeof(uint64_t), compare_u64);
+
+    double seconds = (double)elapsed / 1e9;
+    printf("%-15s %6zu %5zu %12.0f %9.1f %9.1f %9.1f %9.1f %10.0f%s\n",
+           name, workload->message_size, workload->batch,
+           (double)total / seconds,
+           (double)payload_bytes / seconds / 1e6,
+           (double)percentile(all, total, 0.50) / 1e3,
+           (double)percentile(all, total, 0.99) / 1e3,
+           (double)percentile(all, total, 0.999) / 1e3,
+           total ? (double)cpu / (double)total : 0.0,
+           valid ? "" : "  MISMATCH");
+
+    free(all);
+}
+
+static void run(Transport transport, const Workload *workload) {
+    size_t frame_max = sizeof(FrameHeader) + workload->message_size;
+    size_t batch_bytes = frame_max * workload->batch;
+    // +1 so the consumer can NUL-terminate the last payload in place.
+    size_t recv_cap = 2 * batch_bytes + frame_max + 1;
+
+    Channel channels[CONSUMERS];
+    for (int c = 0; c < CONSUMERS; c++) {
+        channel_open(&channels[c], transport, batch_bytes);
+    }
+    if (channels[0].max_send < frame_max) {
+        fprintf(stderr, "%s: message size %zu does not fit one send\n",
+                transport_names[transport], workload->message_size);
+        for (int c = 0; c < CONSUMERS; c++) channel_close(&channels[c]);
+        return;
+    }
+
+    ConsumerResult *results = map_shared(sizeof(ConsumerResult) * CONSUMERS);
+    size_t latency_bytes = sizeof(uint64_t) * (workload->messages + 1);
+    uint64_t *latencies[CONSUMERS];
+    for (int c = 0; c < CONSUMERS; c++) {
+        latencies[c] = map_shared(latency_bytes);
+    }
+
+    fflush(stdout);
+    pid_t children[CONSUMERS];
+    for (int c = 0; c < CONSUMERS; c++) {
+        children[c] = fork();
+        if (children[c] == -1) die("fork");
+        if (children[c] == 0) {
+            for (int other = 0; other < CONSUMERS; other++) {
+                if (channels[other].fds[1] != -1) close(channels[other].fds[1]);
+            }
+            consumer_run(&channels[c], recv_cap, &results[c], latencies[c]);
+            _exit(EXIT_SUCCESS);
+        }
+    }
+    for (int c = 0; c < CONSUMERS; c++) {
+        if (channels[c].fds[0] != -1) {
+            close(channels[c].fds[0]);
+            channels[c].fds[0] = -1;
+        }
+    }
+
+    struct rusage self_before;
+    getrusage(RUSAGE_SELF, &self_before);
+    uint64_t start = now_ns();
+
+    char *message = malloc(workload->message_size);
+    char *batches[CONSUMERS];
+    size_t fill[CONSUMERS] = {0};
+    size_t queued[CONSUMERS] = {0};
+    uint64_t payload_bytes = 0;
+    if (!message) die("malloc");
+    for (int c = 0; c < CONSUMERS; c++) {
+        batches[c] = malloc(batch_bytes + sizeof(FrameHeader));
+        if (!batches[c]) die("malloc");
+    }
+
+    for (size_t i = 0; i < workload->messages; i++) {
+        size_t len = make_message(message, workload->message_size, i);
+        int c = route(len, workload->message_size);
+
+        if (fill[c] + sizeof(FrameHeader) + len > channels[c].max_send) {
+            channel_send(&channels[c], batches[c], fill[c]);
+            fill[c] = 0;
+            queued[c] = 0;
+        }
+
+        FrameHeader header = { (uint32_t)len, (uint32_t)i, now_ns() };
+        memcpy(batches[c] + fill[c], &header, sizeof(header));
+        memcpy(batches[c] + fill[c] + sizeof(header), message, len);
+        fill[c] += sizeof(header) + len;
+        payload_bytes += len;
+
+        if (++queued[c] == workload->batch) {
+            channel_send(&channels[c], batches[c], fill[c]);
+            fill[c] = 0;
+            queued[c] = 0;
+        }
+    }
+    free(message);
+
+    for (int c = 0; c < CONSUMERS; c++) {
+        FrameHeader end = { FRAME_END, 0, 0 };
+        memcpy(batches[c] + fill[c], &end, sizeof(end));
+        channel_send(&channels[c], batches[c], fill[c] + sizeof(end));
+        free(batches[c]);
+    }
+
+    uint64_t children_cpu = 0;
+    for (int c = 0; c < CONSUMERS; c++) {
+        int status;
+        struct rusage ru;
+        if (wait4(children[c], &status, 0, &ru) == -1) die("wait4");
+        children_cpu += rusage_ns(&ru);
+    }
+
+    uint64_t elapsed = now_ns() - start;
+    struct rusage self_after;
+    getrusage(RUSAGE_SELF, &self_after);
+    uint64_t cpu = rusage_ns(&self_after) - rusage_ns(&self_before) + children_cpu;
+
+    report(transport_names[transport], workload, results, latencies, payload_bytes, elapsed, cpu);
+
+    for (int c = 0; c < CONSUMERS; c++) {
+        munmap(latencies[c], latency_bytes);
+        channel_close(&channels[c]);
+    }
+    munmap(results, sizeof(ConsumerResult) * CONSUMERS);
+}
+
+static int pool_route(void *context, const char *data, size_t len) {
+    (void)data;
+    const PoolRun *pool_run = context;
+    return route(len, pool_run->message_size);
+}
+
+static size_t pool_transform(void *context, const char *data, size_t len, char *out) {
+    (void)context;
+    const char *vowels = "AEIOUYaeiouy";
+    size_t j = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (!memchr(vowels, data[i], 12)) {
+            out[j++] = data[i];
+        }
+    }
+    return j;
+}
+
+// FNV-1a is a running hash, so hashing a batch of results at once gives
+// the same checksum as the consumers hashing them one by one.
+static void pool_sink(void *context, int output, const char *data, size_t len,
+                      const uint64_t *tags, size_t count) {
+    PoolRun *pool_run = context;
+    ConsumerResult *result = &pool_run->results[output];
+    uint64_t now = now_ns();
+
+    result->checksum = fnv1a(result->checksum, data, len);
+    for (size_t i = 0; i < count; i++) {
+        pool_run->latencies[output][result->count++] = now - tags[i];
+    }
+}
+
+// The producer loop of run() becomes the pool's reader; a batch carries up
+// to `batch` messages as in the process transports. CPU time covers every
+// thread of the process.
+static void run_threads(const Workload *workload) {
+    PoolRun pool_run = { .message_size = workload->message_size };
+    for (int c = 0; c < CONSUMERS; c++) {
+        pool_run.results[c].checksum = 1469598103934665603ull;
+        pool_run.latencies[c] = malloc(sizeof(uint64_t) * (workload->messages + 1));
+        if (!pool_run.latencies[c]) die("malloc");
+    }
+
+    TransformPoolOptions options = {
+        workload->workers, CONSUMERS, workload->batch, workload->message_size * workload->batch,
+        pool_route, pool_transform, pool_sink, &pool_run
+    };
+    TransformPool *pool = transform_pool_create(&options);
+    if (!pool) {
+        fprintf(stderr, "threads: failed to start %d workers\n", workload->workers);
+        exit(EXIT_FAILURE);
+    }
+
+    char *message = malloc(workload->message_size);
+    if (!message) die("malloc");
+
+    struct rusage before;
+    getrusage(RUSAGE_SELF, &before);
+    uint64_t start = now_ns();
+    uint64_t payload_bytes = 0;
+
+    for (size_t i = 0; i < workload->messages; i++) {
+        size_t len = make_message(message, workload->message_size, i);
+        transform_pool_submit(pool, message, len, now_ns());
+        payload_bytes += len;
+    }
+    transform_pool_finish(pool);
+
+    uint64_t elapsed = now_ns() - start;
+    struct rusage after;
+    getrusage(RUSAGE_SELF, &after);
+
+    char name[32];
+    snprintf(name, sizeof(name), "threads/%d", workload->workers);
+    report(name, workload, pool_run.results, pool_run.latencies, payload_bytes, elapsed,
+           rusage_ns(&after) - rusage_ns(&before));
+
+    free(message);
+    transform_pool_destroy(pool);
+    for (int c = 0; c < CONSUMERS; c++) free(pool_run.latencies[c]);
+}
+
+static size_t parse_list(const char *arg, size_t *out, size_t cap) {
+    size_t count = 0;
+    char *copy = strdup(arg);
+    for (char *token = strtok(copy, ","); token && count < cap; token = strtok(NULL, ",")) {
+        long value = atol(token);
+        if (value > 0) out[count++] = (size_t)value;
+    }
+    free(copy);
+    return count;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "Usage: %s [-n messages] [-s size,size,...] [-b batch,batch,...] [-t transport,...] [-w workers]\n"
+            "transports: pipe shm_sem shm_ring unix_stream unix_seqpacket eventfd_ring threads\n",
+            name);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv) {
+    size_t messages = 200000;
+    size_t sizes[16] = {16, 64, 256, 1024, 4096};
+    size_t size_count = 5;
+    size_t batches[16] = {1, 8, 64};
+    size_t batch_count = 3;
+    int workers = CONSUMERS;
+    bool enabled[TRANSPORT_COUNT];
+    for (int t = 0; t < TRANSPORT_COUNT; t++) enabled[t] = true;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:b:t:w:h")) != -1) {
+        switch (opt) {
+            case 'n':
+                messages = (size_t)atol(optarg);
+                break;
+            case 's':
+                size_count = parse_list(optarg, sizes, 16);
+                break;
+            case 'b':
+                batch_count = parse_list(optarg, batches, 16);
+                break;
+            case 'w':
+                workers = atoi(optarg);
+                break;
+            case 't': {
+                for (int t = 0; t < TRANSPORT_COUNT; t++) enabled[t] = false;
+                char *copy = strdup(optarg);
+                for (char *token = strtok(copy, ","); token; token = strtok(NULL, ",")) {
+                    int t = 0;
+                    while (t < TRANSPORT_COUNT && strcmp(token, transport_names[t]) != 0) t++;
+                    if (t == TRANSPORT_COUNT) usage(argv[0]);
+                    enabled[t] = true;
+                }
+                free(copy);
+                break;
+            }
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (messages == 0 || size_count == 0 || batch_count == 0) usage(argv[0]);
+    if (workers < 1 || workers > TRANSFORM_POOL_MAX_WORKERS) usage(argv[0]);
+
+    printf("%-15s %6s %5s %12s %9s %9s %9s %9s %10s\n",
+           "transport", "size", "batch", "msgs/s", "MB/s", "p50(us)", "p99(us)", "p999(us)", "cpu/msg(ns)");
+
+    for (size_t s = 0; s < size_count; s++) {
+        for (size_t b = 0; b < batch_count; b++) {
+            Workload workload = { messages, sizes[s], batches[b], workers };
+            for (int t = 0; t < TRANSPORT_COUNT; t++) {
+                if (!enabled[t]) continue;
+                if (t == TRANSPORT_THREADS) run_threads(&workload);
+                else run((Transport)t, &workload);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "transform_pool.h"
+
+// laba3 server without the client processes: lines longer than 10
+// characters go to file1, the rest to file2, vowels stripped, with the
+// transforms and file writes done by a transform pool in this process.
+
+#define BATCH_LINES 64
+#define BATCH_BYTES (64 * 1024)
+
+static int route_line(void *context, const char *line, size_t len) {
+    (void)context;
+    (void)line;
+    return len > 10 ? 0 : 1;
+}
+
+static size_t delete_vowels(void *context, const char *line, size_t len, char *out) {
+    (void)context;
+    const char *vowels = "AEIOUYaeiouy";
+    size_t j = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (!memchr(vowels, line[i], 12)) {
+            out[j++] = line[i];
+        }
+    }
+    out[j++] = '\n';
+    return j;
+}
+
+static void write_lines(void *context, int output, const char *data, size_t len,
+                        const uint64_t *tags, size_t count) {
+    (void)tags;
+    (void)count;
+    const int *fds = context;
+
+    while (len > 0) {
+        ssize_t written = write(fds[output], data, len);
+        if (written == -1) {
+            if (errno == EINTR) continue;
+            perror("write");
+            exit(EXIT_FAILURE);
+        }
+        data += written;
+        len -= (size_t)written;
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s file1 file2 [workers]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    int workers = argc > 3 ? atoi(argv[3]) : 2;
+    if (workers < 1 || workers > TRANSFORM_POOL_MAX_WORKERS) {
+        fprintf(stderr, "workers must be in [1, %d]\n", TRANSFORM_POOL_MAX_WORKERS);
+        exit(EXIT_FAILURE);
+    }
+
+    int fds[2];
+    for (int i = 0; i < 2; i++) {
+        fds[i] = open(argv[1 + i], O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fds[i] == -1) {
+            perror("open");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    TransformPoolOptions options = {
+        workers, 2, BATCH_LINES, BATCH_BYTES, route_line, delete_vowels, write_lines, fds
+    };
+    TransformPool *pool = transform_pool_create(&options);
+    if (!pool) {
+        fprintf(stderr, "failed to start the transform pool\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Typed input is flushed line by line, piped input goes in full batches.
+    int interactive = isatty(STDIN_FILENO);
+    char *input = NULL;
+    size_t capacity = 0;
+    ssize_t len;
+
+    while (true) {
+        if (interactive) {
+            printf("Input strings (press ENTER to exit): ");
+            fflush(stdout);
+        }
+        if ((len = getline(&input, &capacity, stdin)) == -1) break;
+
+        if (len > 0 && input[len - 1] == '\n') {
+            input[--len] = '\0';
+        }
+        if (len == 0) break;
+
+        if (transform_pool_submit(pool, input, (size_t)len, 0) != 0) {
+            fprintf(stderr, "line longer than %d bytes skipped\n", BATCH_BYTES);
+            continue;
+        }
+        if (interactive) transform_pool_flush(pool);
+    }
+
+    transform_pool_destroy(pool);
+    free(input);
+    close(fds[0]);
+    close(fds[1]);
+
+    return 0;
+}
@@ -0,0 +1,343 @@
+#define _GNU_SOURCE
+#include "transform_pool.h"
+#include <limits.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define QUEUE_SIZE 64
+#define SLOTS_PER_WORKER 16
+#define SPIN_LIMIT 256
+
+// Counter a thread can sleep on: waiting spins briefly, then futex-waits,
+// so an idle stage costs no CPU and a busy one makes no syscalls.
+typedef struct {
+    _Alignas(64) uint32_t value;
+    uint32_t waiters;
+} PoolWord;
+
+// Records are stored as [uint32_t length][bytes] back to back. `pending`
+// counts the writers that have not consumed the batch yet; the reader
+// reuses the slot once it drops to zero.
+typedef struct TransformBatch {
+    PoolWord pending;
+    size_t count;
+    size_t payload;
+    char *input;
+    uint64_t *tags;
+    char *out[TRANSFORM_POOL_MAX_OUTPUTS];
+    uint64_t *out_tags[TRANSFORM_POOL_MAX_OUTPUTS];
+    size_t out_len[TRANSFORM_POOL_MAX_OUTPUTS];
+    size_t out_count[TRANSFORM_POOL_MAX_OUTPUTS];
+} TransformBatch;
+
+// Bounded ring with one producer and one consumer. A NULL item tells the
+// consumer to stop.
+typedef struct {
+    PoolWord head;
+    PoolWord tail;
+    TransformBatch *items[QUEUE_SIZE];
+} PoolQueue;
+
+typedef struct {
+    TransformPool *pool;
+    int index;
+} PoolThread;
+
+// `work` has one queue per worker, `results` one per worker and output.
+// Batch k always lives in slot k % slot_count. Spinning only pays off
+// when the other side runs on another CPU, so `spin_limit` is 0 on one.
+struct TransformPool {
+    TransformPoolOptions options;
+    int spin_limit;
+    TransformBatch *slots;
+    size_t slot_count;
+    TransformBatch *current;
+    uint64_t next_batch;
+    PoolQueue *work;
+    PoolQueue *results;
+    int running;
+    pthread_t workers[TRANSFORM_POOL_MAX_WORKERS];
+    pthread_t writers[TRANSFORM_POOL_MAX_OUTPUTS];
+    PoolThread worker_args[TRANSFORM_POOL_MAX_WORKERS];
+    PoolThread writer_args[TRANSFORM_POOL_MAX_OUTPUTS];
+};
+
+static void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static void futex_wait(uint32_t *word, uint32_t seen) {
+    syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, seen, NULL, NULL, 0);
+}
+
+static void futex_wake(uint32_t *word) {
+    syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+// Returns once the value is no longer `seen`.
+static void word_wait(const TransformPool *pool, PoolWord *word, uint32_t seen) {
+    for (int i = 0; i < pool->spin_limit; i++) {
+        if (__atomic_load_n(&word->value, __ATOMIC_ACQUIRE) != seen) return;
+        cpu_relax();
+    }
+
+    // Paired with the seq_cst store and waiters load in word_set: either
+    // the setter sees the waiter or the waiter sees the new value.
+    __atomic_fetch_add(&word->waiters, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&word->value, __ATOMIC_SEQ_CST) == seen) futex_wait(&word->value, seen);
+    __atomic_fetch_sub(&word->waiters, 1, __ATOMIC_RELEASE);
+}
+
+static void word_set(PoolWord *word, uint32_t value) {
+    __atomic_store_n(&word->value, value, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&word->waiters, __ATOMIC_SEQ_CST)) futex_wake(&word->value);
+}
+
+static void queue_push(const TransformPool *pool, PoolQueue *queue, TransformBatch *batch) {
+    uint32_t tail = __atomic_load_n(&queue->tail.value, __ATOMIC_RELAXED);
+    uint32_t head;
+    while (tail - (head = __atomic_load_n(&queue->head.value, __ATOMIC_ACQUIRE)) == QUEUE_SIZE) {
+        word_wait(pool, &queue->head, head);
+    }
+
+    queue->items[tail % QUEUE_SIZE] = batch;
+    word_set(&queue->tail, tail + 1);
+}
+
+static TransformBatch *queue_pop(const TransformPool *pool, PoolQueue *queue) {
+    uint32_t head = __atomic_load_n(&queue->head.value, __ATOMIC_RELAXED);
+    while (__atomic_load_n(&queue->tail.value, __ATOMIC_ACQUIRE) == head) {
+        word_wait(pool, &queue->tail, head);
+    }
+
+    TransformBatch *batch = queue->items[head % QUEUE_SIZE];
+    word_set(&queue->head, head + 1);
+    return batch;
+}
+
+static void *aligned_calloc(size_t count, size_t size) {
+    void *memory = NULL;
+    if (posix_memalign(&memory, 64, count * size) != 0) return NULL;
+    memset(memory, 0, count * size);
+    return memory;
+}
+
+static void transform_batch(TransformPool *pool, TransformBatch *batch) {
+    const TransformPoolOptions *options = &pool->options;
+    for (int c = 0; c < options->outputs; c++) {
+        batch->out_len[c] = 0;
+        batch->out_count[c] = 0;
+    }
+
+    const char *record = batch->input;
+    for (size_t i = 0; i < batch->count; i++) {
+        uint32_t len;
+        memcpy(&len, record, sizeof(len));
+        record += sizeof(len);
+
+        int c = options->route(options->context, record, len);
+        if (c >= 0 && c < options->outputs) {
+            batch->out_len[c] += options->transform(options->context, record, len, batch->out[c] + batch->out_len[c]);
+            batch->out_tags[c][batch->out_count[c]++] = batch->tags[i];
+        }
+        record += len;
+    }
+}
+
+static void *worker_main(void *raw) {
+    PoolThread *self = raw;
+    TransformPool *pool = self->pool;
+    int outputs = pool->options.outputs;
+
+    for (;;) {
+        TransformBatch *batch = queue_pop(pool, &pool->work[self->index]);
+        if (batch) transform_batch(pool, batch);
+        for (int c = 0; c < outputs; c++) {
+            queue_push(pool, &pool->results[self->index * outputs + c], batch);
+        }
+        if (!batch) return NULL;
+    }
+}
+
+// A NULL from the worker that owns the next batch means there is no next
+// batch: the reader stops every worker only after its last dispatch.
+static void *writer_main(void *raw) {
+    PoolThread *self = raw;
+    TransformPool *pool = self->pool;
+    const TransformPoolOptions *options = &pool->options;
+    int c = self->index;
+
+    for (uint64_t k = 0;; k++) {
+        int worker = (int)(k % (uint64_t)options->workers);
+        TransformBatch *batch = queue_pop(pool, &pool->results[worker * options->outputs + c]);
+        if (!batch) return NULL;
+
+        if (batch->out_count[c]) {
+            options->sink(options->context, c, batch->out[c], batch->out_len[c], batch->out_tags[c],
+                          batch->out_count[c]);
+        }
+        if (__atomic_sub_fetch(&batch->pending.value, 1, __ATOMIC_SEQ_CST) == 0
+            && __atomic_load_n(&batch->pending.waiters, __ATOMIC_SEQ_CST)) {
+            futex_wake(&batch->pending.value);
+        }
+    }
+}
+
+static void dispatch(TransformPool *pool) {
+    TransformBatch *batch = pool->current;
+    if (!batch) return;
+
+    pool->current = NULL;
+    __atomic_store_n(&batch->pending.value, (uint32_t)pool->options.outputs, __ATOMIC_RELAXED);
+    queue_push(pool, &pool->work[pool->next_batch % (uint64_t)pool->options.workers], batch);
+    pool->next_batch++;
+}
+
+static TransformBatch *acquire_batch(TransformPool *pool) {
+    TransformBatch *batch = &pool->slots[pool->next_batch % pool->slot_count];
+    uint32_t left;
+    while ((left = __atomic_load_n(&batch->pending.value, __ATOMIC_ACQUIRE)) != 0) {
+        word_wait(pool, &batch->pending, left);
+    }
+
+    batch->count = 0;
+    batch->payload = 0;
+    return batch;
+}
+
+// Writers only start once every worker runs, and a writer begins with
+// worker 0, so stopping the workers also stops every writer.
+static void stop_threads(TransformPool *pool, int workers, int writers) {
+    for (int w = 0; w < workers; w++) queue_push(pool, &pool->work[w], NULL);
+    for (int w = 0; w < workers; w++) pthread_join(pool->workers[w], NULL);
+    for (int c = 0; c < writers; c++) pthread_join(pool->writers[c], NULL);
+}
+
+static void free_slots(TransformPool *pool) {
+    for (size_t i = 0; i < pool->slot_count; i++) {
+        TransformBatch *batch = &pool->slots[i];
+        free(batch->input);
+        free(batch->tags);
+        for (int c = 0; c < TRANSFORM_POOL_MAX_OUTPUTS; c++) {
+            free(batch->out[c]);
+            free(batch->out_tags[c]);
+        }
+    }
+    free(pool->slots);
+}
+
+static void free_pool(TransformPool *pool) {
+    if (pool->slots) free_slots(pool);
+    free(pool->work);
+    free(pool->results);
+    free(pool);
+}
+
+TransformPool *transform_pool_create(const TransformPoolOptions *options) {
+    if (!options || !options->route || !options->transform || !options->sink) return NULL;
+    if (options->workers < 1 || options->workers > TRANSFORM_POOL_MAX_WORKERS) return NULL;
+    if (options->outputs < 1 || options->outputs > TRANSFORM_POOL_MAX_OUTPUTS) return NULL;
+    if (options->batch_records == 0 || options->batch_bytes == 0 || options->batch_bytes > UINT32_MAX) return NULL;
+
+    TransformPool *pool = aligned_calloc(1, sizeof(TransformPool));
+    if (!pool) return NULL;
+    pool->options = *options;
+    pool->spin_limit = sysconf(_SC_NPROCESSORS_ONLN) < 2 ? 0 : SPIN_LIMIT;
+
+    // Input holds each record's length prefix, an output at most every
+    // record plus the one extra byte a transform may add.
+    size_t records = options->batch_records;
+    size_t input_bytes = options->batch_bytes + records * sizeof(uint32_t);
+    size_t output_bytes = options->batch_bytes + records;
+
+    pool->slot_count = (size_t)options->workers * SLOTS_PER_WORKER;
+    pool->slots = aligned_calloc(pool->slot_count, sizeof(TransformBatch));
+    pool->work = aligned_calloc((size_t)options->workers, sizeof(PoolQueue));
+    pool->results = aligned_calloc((size_t)options->workers * (size_t)options->outputs, sizeof(PoolQueue));
+    if (!pool->slots || !pool->work || !pool->results) {
+        free_pool(pool);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < pool->slot_count; i++) {
+        TransformBatch *batch = &pool->slots[i];
+        batch->input = malloc(input_bytes);
+        batch->tags = malloc(records * sizeof(uint64_t));
+        if (!batch->input || !batch->tags) {
+            free_pool(pool);
+            return NULL;
+        }
+        for (int c = 0; c < options->outputs; c++) {
+            batch->out[c] = malloc(output_bytes);
+            batch->out_tags[c] = malloc(records * sizeof(uint64_t));
+            if (!batch->out[c] || !batch->out_tags[c]) {
+                free_pool(pool);
+                return NULL;
+            }
+        }
+    }
+
+    for (int w = 0; w < options->workers; w++) {
+        pool->worker_args[w] = (PoolThread){pool, w};
+        if (pthread_create(&pool->workers[w], NULL, worker_main, &pool->worker_args[w]) != 0) {
+            stop_threads(pool, w, 0);
+            free_pool(pool);
+            return NULL;
+        }
+    }
+    for (int c = 0; c < options->outputs; c++) {
+        pool->writer_args[c] = (PoolThread){pool, c};
+        if (pthread_create(&pool->writers[c], NULL, writer_main, &pool->writer_args[c]) != 0) {
+            stop_threads(pool, options->workers, c);
+            free_pool(pool);
+            return NULL;
+        }
+    }
+
+    pool->running = 1;
+    return pool;
+}
+
+int transform_pool_submit(TransformPool *pool, const char *data, size_t len, uint64_t tag) {
+    if (!pool->running || len > pool->options.batch_bytes) return -1;
+
+    TransformBatch *batch = pool->current;
+    if (batch && (batch->count == pool->options.batch_records || batch->payload + len > pool->options.batch_bytes)) {
+        dispatch(pool);
+        batch = NULL;
+    }
+    if (!batch) batch = pool->current = acquire_batch(pool);
+
+    char *record = batch->input + batch->payload + batch->count * sizeof(uint32_t);
+    uint32_t length = (uint32_t)len;
+    memcpy(record, &length, sizeof(length));
+    memcpy(record + sizeof(length), data, len);
+    batch->tags[batch->count++] = tag;
+    batch->payload += len;
+    return 0;
+}
+
+void transform_pool_flush(TransformPool *pool) {
+    if (pool->running) dispatch(pool);
+}
+
+void transform_pool_finish(TransformPool *pool) {
+    if (!pool->running) return;
+
+    dispatch(pool);
+    stop_threads(pool, pool->options.workers, pool->options.outputs);
+    pool->running = 0;
+}
+
+void transform_pool_destroy(TransformPool *pool) {
+    if (!pool) return;
+
+    transform_pool_finish(pool);
+    free_pool(pool);
+}
@@ -0,0 +1,46 @@
+#ifndef TRANSFORM_POOL_H
+#define TRANSFORM_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// In-process version of the route-and-transform pipeline: the thread that
+// submits records is the reader, `workers` transform threads route and
+// transform whole batches, and one writer thread per output hands results
+// to the sink in submission order.
+//
+// Every queue has a single producer and a single consumer. Batch k goes
+// to worker k % workers and each writer takes batches from the workers in
+// the same rotation, so order is kept without a reorder buffer.
+
+#define TRANSFORM_POOL_MAX_WORKERS 64
+#define TRANSFORM_POOL_MAX_OUTPUTS 8
+
+typedef struct {
+    int workers;
+    int outputs;
+    size_t batch_records;
+    size_t batch_bytes;
+    // Output index in [0, outputs), anything else drops the record.
+    int (*route)(void *context, const char *data, size_t len);
+    // Writes the result to `out`, which has room for len + 1 bytes.
+    size_t (*transform)(void *context, const char *data, size_t len, char *out);
+    // One call per batch and output, from that output's writer thread.
+    // `tags` are the values passed to submit, one per record.
+    void (*sink)(void *context, int output, const char *data, size_t len, const uint64_t *tags, size_t count);
+    void *context;
+} TransformPoolOptions;
+
+typedef struct TransformPool TransformPool;
+
+TransformPool *transform_pool_create(const TransformPoolOptions *options);
+// Copies one record into the current batch. Fails on records longer than
+// batch_bytes. Not thread-safe: there is one reader.
+int transform_pool_submit(TransformPool *pool, const char *data, size_t len, uint64_t tag);
+// Hands a partially filled batch to the workers.
+void transform_pool_flush(TransformPool *pool);
+// Flushes, waits until every record reached its sink and joins the threads.
+void transform_pool_finish(TransformPool *pool);
+void transform_pool_destroy(TransformPool *pool);
+
+#endif // TRANSFORM_POOL_H
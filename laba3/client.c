@@ -8,6 +8,8 @@
 #include <string.h>
 #include <semaphore.h>
 
+#include "latency.h"
+
 #define SHM_NAME "/shared_memory"
 #define BUFFER_SIZE 4096
 
@@ -18,6 +20,9 @@ typedef struct {
     sem_t sem_child1;
     sem_t sem_child2;
     bool exit_flag;
+    uint64_t stamp1;
+    uint64_t stamp2;
+    LatencyTrace trace;
 } SharedMemory;
 
 void delete_vowels(char *str) {
@@ -59,13 +64,19 @@ int main(int argc, char **argv) {
 
     sem_t *my_sem;
     char *my_buffer;
+    uint64_t *my_stamp;
+    TraceProcess me;
 
     if (strcmp(argv[1], "client1") == 0) {
         my_sem = &shm->sem_child1;
         my_buffer = shm->buffer1;
+        my_stamp = &shm->stamp1;
+        me = TRACE_CLIENT1;
     } else {
         my_sem = &shm->sem_child2;
         my_buffer = shm->buffer2;
+        my_stamp = &shm->stamp2;
+        me = TRACE_CLIENT2;
     }
 
     while (true) {
@@ -73,8 +84,13 @@ int main(int argc, char **argv) {
 
         if (shm->exit_flag) break;
 
+        latency_record(&shm->trace, me, STAGE_QUEUE, *my_stamp);
+
+        uint64_t transform_start = latency_now_ns();
         delete_vowels(my_buffer);
+        latency_record(&shm->trace, me, STAGE_TRANSFORM, transform_start);
 
+        uint64_t write_start = latency_now_ns();
         size_t len = strlen(my_buffer);
         if (write(output_file, my_buffer, len) == -1) {
             perror("write");
@@ -82,6 +98,7 @@ int main(int argc, char **argv) {
         }
 
         write(output_file, "\n", 1);
+        latency_record(&shm->trace, me, STAGE_WRITE, write_start);
 
         sem_post(&shm->sem_parent);
     }
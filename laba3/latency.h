@@ -0,0 +1,172 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Log-linear (HDR-style) histogram: every power of two is split into
+// 2^LATENCY_SUB_BITS linear sub-buckets, so the relative error of any
+// reported percentile stays below 1 / 2^LATENCY_SUB_BITS.
+#define LATENCY_SUB_BITS 4
+#define LATENCY_SUB_COUNT (1u << LATENCY_SUB_BITS)
+#define LATENCY_MAX_BITS 40
+#define LATENCY_BUCKETS ((LATENCY_MAX_BITS - LATENCY_SUB_BITS + 1) * LATENCY_SUB_COUNT)
+
+typedef enum {
+    STAGE_SLOT_WAIT,  // server: waiting on sem_parent for a free slot
+    STAGE_ENQUEUE,    // server: route + copy into the slot until sem_post
+    STAGE_QUEUE,      // client: enqueue timestamp until sem_wait returns
+    STAGE_TRANSFORM,  // client: delete_vowels
+    STAGE_WRITE,      // client: write to the output file
+    STAGE_COUNT
+} LatencyStage;
+
+typedef enum {
+    TRACE_SERVER,
+    TRACE_CLIENT1,
+    TRACE_CLIENT2,
+    TRACE_PROCESS_COUNT
+} TraceProcess;
+
+typedef struct {
+    uint64_t count;
+    uint64_t max;
+    uint64_t buckets[LATENCY_BUCKETS];
+} LatencyHistogram;
+
+// Lives in the shared segment. Each process writes only its own row,
+// so recording needs no locking; readers may see slightly stale counts.
+typedef struct {
+    bool enabled;
+    LatencyHistogram hist[TRACE_PROCESS_COUNT][STAGE_COUNT];
+} LatencyTrace;
+
+static const char *const latency_stage_names[STAGE_COUNT] = {
+    "slot_wait", "enqueue", "queue", "transform", "write"
+};
+
+static const char *const latency_process_names[TRACE_PROCESS_COUNT] = {
+    "server", "client1", "client2"
+};
+
+static inline uint64_t latency_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint32_t latency_bucket(uint64_t value) {
+    if (value < LATENCY_SUB_COUNT) return (uint32_t)value;
+
+    uint32_t msb = 63 - (uint32_t)__builtin_clzll(value);
+    if (msb >= LATENCY_MAX_BITS) return LATENCY_BUCKETS - 1;
+
+    uint32_t shift = msb - LATENCY_SUB_BITS;
+    uint32_t sub = (uint32_t)(value >> shift) & (LATENCY_SUB_COUNT - 1);
+    return (shift + 1) * LATENCY_SUB_COUNT + sub;
+}
+
+// Upper bound of the values that fall into the given bucket.
+static inline uint64_t latency_bucket_value(uint32_t bucket) {
+    if (bucket < LATENCY_SUB_COUNT) return bucket;
+
+    uint32_t shift = bucket / LATENCY_SUB_COUNT - 1;
+    uint64_t sub = bucket % LATENCY_SUB_COUNT;
+    return ((LATENCY_SUB_COUNT + sub + 1) << shift) - 1;
+}
+
+static inline void latency_record(LatencyTrace *trace, TraceProcess process,
+                                  LatencyStage stage, uint64_t start_ns) {
+    if (!trace->enabled) return;
+
+    uint64_t value = latency_now_ns() - start_ns;
+    LatencyHistogram *hist = &trace->hist[process][stage];
+    __atomic_fetch_add(&hist->buckets[latency_bucket(value)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->count, 1, __ATOMIC_RELAXED);
+    if (value > __atomic_load_n(&hist->max, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&hist->max, value, __ATOMIC_RELAXED);
+    }
+}
+
+static inline uint64_t latency_percentile(const LatencyHistogram *hist, uint64_t count,
+                                          uint32_t per_mille) {
+    uint64_t target = (count * per_mille + 999) / 1000;
+    if (target == 0) target = 1;
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+        if (seen >= target) return latency_bucket_value(i);
+    }
+    return __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+}
+
+// Formatting below avoids stdio so the dump can run from a signal handler.
+static inline size_t latency_append(char *buf, size_t pos, size_t cap, const char *str) {
+    while (*str && pos < cap) buf[pos++] = *str++;
+    return pos;
+}
+
+static inline size_t latency_append_u64(char *buf, size_t pos, size_t cap, uint64_t value) {
+    char digits[20];
+    size_t n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (n && pos < cap) buf[pos++] = digits[--n];
+    return pos;
+}
+
+static inline size_t latency_append_padded(char *buf, size_t pos, size_t cap,
+                                           const char *str, size_t width) {
+    size_t len = strlen(str);
+    pos = latency_append(buf, pos, cap, str);
+    while (len++ < width && pos < cap) buf[pos++] = ' ';
+    return pos;
+}
+
+static inline void latency_dump(const LatencyTrace *trace, int fd,
+                                const int *slots_occupied, int slots) {
+    char buf[256];
+    size_t pos;
+
+    for (int p = 0; p < TRACE_PROCESS_COUNT; p++) {
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            const LatencyHistogram *hist = &trace->hist[p][s];
+            uint64_t count = __atomic_load_n(&hist->count, __ATOMIC_RELAXED);
+            if (count == 0) continue;
+
+            pos = 0;
+            pos = latency_append_padded(buf, pos, sizeof(buf), latency_process_names[p], 8);
+            pos = latency_append_padded(buf, pos, sizeof(buf), latency_stage_names[s], 10);
+            pos = latency_append(buf, pos, sizeof(buf), " n=");
+            pos = latency_append_u64(buf, pos, sizeof(buf), count);
+            pos = latency_append(buf, pos, sizeof(buf), " p50=");
+            pos = latency_append_u64(buf, pos, sizeof(buf), latency_percentile(hist, count, 500));
+            pos = latency_append(buf, pos, sizeof(buf), "ns p99=");
+            pos = latency_append_u64(buf, pos, sizeof(buf), latency_percentile(hist, count, 990));
+            pos = latency_append(buf, pos, sizeof(buf), "ns p999=");
+            pos = latency_append_u64(buf, pos, sizeof(buf), latency_percentile(hist, count, 999));
+            pos = latency_append(buf, pos, sizeof(buf), "ns max=");
+            pos = latency_append_u64(buf, pos, sizeof(buf), __atomic_load_n(&hist->max, __ATOMIC_RELAXED));
+            pos = latency_append(buf, pos, sizeof(buf), "ns\n");
+            write(fd, buf, pos);
+        }
+    }
+
+    pos = latency_append(buf, 0, sizeof(buf), "slot occupied:");
+    for (int q = 0; q < slots; q++) {
+        pos = latency_append(buf, pos, sizeof(buf), " client");
+        pos = latency_append_u64(buf, pos, sizeof(buf), (uint64_t)(q + 1));
+        pos = latency_append(buf, pos, sizeof(buf), "=");
+        pos = latency_append_u64(buf, pos, sizeof(buf), (uint64_t)slots_occupied[q]);
+    }
+    pos = latency_append(buf, pos, sizeof(buf), "\n");
+    write(fd, buf, pos);
+}
+
+#endif // LATENCY_H
@@ -8,6 +8,10 @@
 #include <string.h>
 #include <semaphore.h>
 #include <sys/wait.h>
+#include <signal.h>
+#include <errno.h>
+
+#include "latency.h"
 
 #define SHM_NAME "/shared_memory"
 #define BUFFER_SIZE 4096
@@ -19,8 +23,25 @@ typedef struct {
     sem_t sem_child1;
     sem_t sem_child2;
     bool exit_flag;
+    uint64_t stamp1;
+    uint64_t stamp2;
+    LatencyTrace trace;
 } SharedMemory;
 
+static SharedMemory *traced_shm = NULL;
+
+static void dump_trace(int signo) {
+    (void)signo;
+    if (!traced_shm) return;
+
+    // Each client has a single slot, so its semaphore only says whether
+    // a line is waiting there.
+    int occupied[2];
+    sem_getvalue(&traced_shm->sem_child1, &occupied[0]);
+    sem_getvalue(&traced_shm->sem_child2, &occupied[1]);
+    latency_dump(&traced_shm->trace, STDERR_FILENO, occupied, 2);
+}
+
 int main(int argc, char **argv) {
     if (argc < 3) {
         fprintf(stderr, "Usage: %s file1 file2\n", argv[0]);
@@ -48,6 +69,25 @@ int main(int argc, char **argv) {
     sem_init(&shm->sem_child1, 1, 0);
     sem_init(&shm->sem_child2, 1, 0);
     shm->exit_flag = false;
+    memset(&shm->trace, 0, sizeof(shm->trace));
+
+    // NOTE: `LABA3_TRACE=1` enables per-stage latency histograms,
+    // `kill -USR1 <server pid>` prints them while the pipeline runs
+    const char *trace_env = getenv("LABA3_TRACE");
+    if (trace_env && strcmp(trace_env, "0") != 0) {
+        shm->trace.enabled = true;
+        traced_shm = shm;
+
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = dump_trace;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        if (sigaction(SIGUSR1, &sa, NULL) == -1) {
+            perror("sigaction");
+            exit(EXIT_FAILURE);
+        }
+    }
 
     pid_t child1 = fork();
     if (child1 == 0) {
@@ -65,7 +105,14 @@ int main(int argc, char **argv) {
 
     char input[BUFFER_SIZE];
     while (true) {
-        sem_wait(&shm->sem_parent);
+        uint64_t wait_start = latency_now_ns();
+        // SIGUSR1 interrupts sem_wait even with SA_RESTART
+        while (sem_wait(&shm->sem_parent) == -1) {
+            if (errno == EINTR) continue;
+            perror("sem_wait");
+            exit(EXIT_FAILURE);
+        }
+        latency_record(&shm->trace, TRACE_SERVER, STAGE_SLOT_WAIT, wait_start);
 
         printf("Input strings (press ENTER to exit): ");
         if (fgets(input, sizeof(input), stdin) == NULL) {
@@ -73,6 +120,8 @@ int main(int argc, char **argv) {
             continue;
         }
 
+        uint64_t enqueue_start = latency_now_ns();
+
         size_t len = strlen(input);
         if (len > 0 && input[len - 1] == '\n') {
             input[len - 1] = '\0';
@@ -88,10 +137,14 @@ int main(int argc, char **argv) {
         if (strlen(input) > 10) {
             strncpy(shm->buffer1, input, BUFFER_SIZE - 1);
             shm->buffer1[BUFFER_SIZE - 1] = '\0';
+            latency_record(&shm->trace, TRACE_SERVER, STAGE_ENQUEUE, enqueue_start);
+            shm->stamp1 = latency_now_ns();
             sem_post(&shm->sem_child1);
         } else {
             strncpy(shm->buffer2, input, BUFFER_SIZE - 1);
             shm->buffer2[BUFFER_SIZE - 1] = '\0';
+            latency_record(&shm->trace, TRACE_SERVER, STAGE_ENQUEUE, enqueue_start);
+            shm->stamp2 = latency_now_ns();
             sem_post(&shm->sem_child2);
         }
     }
@@ -99,6 +152,11 @@ int main(int argc, char **argv) {
     wait(NULL);
     wait(NULL);
 
+    if (shm->trace.enabled) {
+        dump_trace(0);
+        traced_shm = NULL;
+    }
+
     sem_destroy(&shm->sem_parent);
     sem_destroy(&shm->sem_child1);
     sem_destroy(&shm->sem_child2);
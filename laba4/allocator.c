@@ -1,15 +1,44 @@
 #include "allocator.h"
+#include <string.h>
+
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static char* base_of(const Allocator* allocator) {
+    return (char*)allocator;
+}
+
+static void* address_of(const Allocator* allocator, FreeListLink link) {
+    return link ? base_of(allocator) + link : NULL;
+}
+
+static FreeListLink link_of(const Allocator* allocator, const void* memory) {
+    return (FreeListLink)((const char*)memory - base_of(allocator));
+}
+
+static void note_growth(Allocator* allocator) {
+    size_t live = allocator->heap.size - allocator->heap.free_bytes;
+    if (live > allocator->peak_bytes) allocator->peak_bytes = live;
+}
 
 Allocator* allocator_create(void* memory, size_t size) {
-    if (size < sizeof(FreeBlock)) return NULL;
+    if (!memory || size < sizeof(Allocator)) return NULL;
+
+    // The first block starts at an aligned address, not an aligned offset.
+    size_t start = align_up((size_t)memory + sizeof(Allocator), ALLOCATOR_ALIGNMENT) - (size_t)memory;
+    if (start >= size) return NULL;
 
     Allocator* allocator = (Allocator*)memory;
-    allocator->memory_start = (char*)memory + sizeof(Allocator);
-    allocator->memory_size = size - sizeof(Allocator);
-    allocator->free_list = (FreeBlock*)allocator->memory_start;
+    if (free_list_init(&allocator->heap, base_of(allocator), start, size - start) != 0) return NULL;
 
-    allocator->free_list->size = allocator->memory_size;
-    allocator->free_list->next = NULL;
+    allocator->peak_bytes = 0;
+    allocator->alloc_count = 0;
+    allocator->free_count = 0;
+    allocator->realloc_count = 0;
+    for (unsigned i = 0; i < ALLOCATOR_CLASS_COUNT; i++) {
+        allocator->class_allocs[i] = 0;
+    }
 
     return allocator;
 }
@@ -19,41 +48,89 @@ void allocator_destroy(Allocator* allocator) {
 }
 
 void* allocator_alloc(Allocator* allocator, size_t size) {
-    if (size == 0) return NULL;
-
-    FreeBlock* prev = NULL;
-    FreeBlock* current = allocator->free_list;
-
-    while (current) {
-        if (current->size >= size + sizeof(FreeBlock)) {
-            if (current->size > size + sizeof(FreeBlock)) {
-                FreeBlock* new_block = (FreeBlock*)((char*)current + sizeof(FreeBlock) + size);
-                new_block->size = current->size - size - sizeof(FreeBlock);
-                new_block->next = current->next;
-                current->next = new_block;
-            }
-
-            if (prev) {
-                prev->next = current->next;
-            } else {
-                allocator->free_list = current->next;
-            }
-
-            current->size = size;
-            return (char*)current + sizeof(FreeBlock);
-        }
-
-        prev = current;
-        current = current->next;
-    }
+    unsigned index;
+    FreeListLink payload = free_list_alloc(&allocator->heap, base_of(allocator), size, &index);
+    if (!payload) return NULL;
 
-    return NULL;
+    allocator->alloc_count++;
+    allocator->class_allocs[index]++;
+    note_growth(allocator);
+    return address_of(allocator, payload);
 }
 
 void allocator_free(Allocator* allocator, void* memory) {
     if (!memory) return;
 
-    FreeBlock* block_to_free = (FreeBlock*)((char*)memory - sizeof(FreeBlock));
-    block_to_free->next = allocator->free_list;
-    allocator->free_list = block_to_free;
+    allocator->free_count++;
+    free_list_free(&allocator->heap, base_of(allocator), link_of(allocator, memory));
+}
+
+void* allocator_aligned_alloc(Allocator* allocator, size_t alignment, size_t size) {
+    unsigned index;
+    FreeListLink payload = free_list_aligned_alloc(&allocator->heap, base_of(allocator), alignment, size, &index);
+    if (!payload) return NULL;
+
+    allocator->alloc_count++;
+    allocator->class_allocs[index]++;
+    note_growth(allocator);
+    return address_of(allocator, payload);
+}
+
+void* allocator_realloc(Allocator* allocator, void* memory, size_t size) {
+    if (!memory) return allocator_alloc(allocator, size);
+    if (size == 0) {
+        allocator_free(allocator, memory);
+        return NULL;
+    }
+    if (size > allocator->heap.size) return NULL;
+
+    allocator->realloc_count++;
+    if (free_list_resize(&allocator->heap, base_of(allocator), link_of(allocator, memory), size) == 0) {
+        note_growth(allocator);
+        return memory;
+    }
+
+    void* moved = allocator_alloc(allocator, size);
+    if (!moved) return NULL;
+
+    memcpy(moved, memory, allocator_usable_size(allocator, memory));
+    allocator_free(allocator, memory);
+    return moved;
+}
+
+size_t allocator_usable_size(const Allocator* allocator, const void* memory) {
+    return free_list_usable_size(base_of(allocator), link_of(allocator, memory));
+}
+
+size_t allocator_free_bytes(const Allocator* allocator) {
+    return allocator->heap.free_bytes;
+}
+
+size_t allocator_largest_free_block(const Allocator* allocator) {
+    return free_list_largest_free_block(&allocator->heap, base_of(allocator));
+}
+
+double allocator_fragmentation(const Allocator* allocator) {
+    return free_list_fragmentation(&allocator->heap, base_of(allocator));
+}
+
+void allocator_stats(const Allocator* allocator, AllocatorStats* stats) {
+    stats->capacity = allocator->heap.size;
+    stats->live_bytes = allocator->heap.size - allocator->heap.free_bytes;
+    stats->peak_bytes = allocator->peak_bytes;
+    stats->free_bytes = allocator->heap.free_bytes;
+    stats->largest_free_block = allocator_largest_free_block(allocator);
+    stats->fragmentation = allocator_fragmentation(allocator);
+    stats->alloc_count = allocator->alloc_count;
+    stats->free_count = allocator->free_count;
+    stats->realloc_count = allocator->realloc_count;
+
+    for (unsigned i = 0; i < ALLOCATOR_CLASS_COUNT; i++) {
+        stats->class_allocs[i] = allocator->class_allocs[i];
+    }
+    free_list_lengths(&allocator->heap, base_of(allocator), stats->free_list_lengths);
+}
+
+int allocator_validate(const Allocator* allocator) {
+    return free_list_validate(&allocator->heap, base_of(allocator));
 }
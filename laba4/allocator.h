@@ -2,21 +2,66 @@
 #define ALLOCATOR_H
 
 #include <stddef.h>
+#include <stdint.h>
 
-typedef struct FreeBlock {
-    size_t size;
-    struct FreeBlock* next;
-} FreeBlock;
+#include "free_list.h"
 
+// Size classes and alignment come from the shared free-list core.
+#define ALLOCATOR_ALIGNMENT FREE_LIST_ALIGNMENT
+#define ALLOCATOR_SMALL_LIMIT FREE_LIST_SMALL_LIMIT
+#define ALLOCATOR_SMALL_CLASSES FREE_LIST_SMALL_CLASSES
+#define ALLOCATOR_CLASS_COUNT FREE_LIST_CLASS_COUNT
+
+// The heap's links are offsets from the Allocator itself. Counters are
+// bumped on every operation and cost a few adds; anything that needs a
+// walk is left to allocator_stats.
 typedef struct Allocator {
-    void* memory_start;
-    size_t memory_size;
-    FreeBlock* free_list;
+    FreeListHeap heap;
+    size_t peak_bytes;
+    size_t alloc_count;
+    size_t free_count;
+    size_t realloc_count;
+    size_t class_allocs[ALLOCATOR_CLASS_COUNT];
 } Allocator;
 
+// Snapshot filled by allocator_stats. Byte counts include block headers,
+// `class_allocs` counts allocations served per size class since creation.
+typedef struct AllocatorStats {
+    size_t capacity;
+    size_t live_bytes;
+    size_t peak_bytes;
+    size_t free_bytes;
+    size_t largest_free_block;
+    double fragmentation;
+    size_t alloc_count;
+    size_t free_count;
+    size_t realloc_count;
+    size_t class_allocs[ALLOCATOR_CLASS_COUNT];
+    size_t free_list_lengths[ALLOCATOR_CLASS_COUNT];
+} AllocatorStats;
+
 Allocator* allocator_create(void* memory, size_t size);
 void allocator_destroy(Allocator* allocator);
 void* allocator_alloc(Allocator* allocator, size_t size);
 void allocator_free(Allocator* allocator, void* memory);
+// Shrinks in place and grows into a free successor before falling back to
+// alloc, copy and free.
+void* allocator_realloc(Allocator* allocator, void* memory, size_t size);
+// `alignment` must be a power of two.
+void* allocator_aligned_alloc(Allocator* allocator, size_t alignment, size_t size);
+size_t allocator_usable_size(const Allocator* allocator, const void* memory);
+
+// Fragmentation metrics: total free bytes, the largest single allocation
+// that can currently succeed, and 1 - largest_free_block / free_bytes.
+size_t allocator_free_bytes(const Allocator* allocator);
+size_t allocator_largest_free_block(const Allocator* allocator);
+double allocator_fragmentation(const Allocator* allocator);
+
+// Walks the free lists, O(free blocks).
+void allocator_stats(const Allocator* allocator, AllocatorStats* stats);
+
+// Walks the whole heap and cross-checks boundary tags, free lists and
+// counters. Returns 0 if the heap is consistent, -1 otherwise.
+int allocator_validate(const Allocator* allocator);
 
 #endif // ALLOCATOR_H
@@ -0,0 +1,40 @@
+#ifndef ALLOCATOR_API_H
+#define ALLOCATOR_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Every allocator plugin module exports one `const AllocatorApi` under
+// ALLOCATOR_API_SYMBOL, so callers pick an implementation with
+// dlopen/dlsym instead of linking against it. Plugins must never be
+// linked directly: two of them in one link would collide on the symbol. Bump the version on any
+// incompatible change; fields are only ever appended.
+#define ALLOCATOR_API_VERSION 1
+#define ALLOCATOR_API_SYMBOL "allocator_api"
+
+typedef struct AllocatorApiStats {
+    size_t capacity;
+    size_t free_bytes;
+    size_t largest_free_block;
+    size_t live_bytes;
+    size_t peak_bytes;
+    size_t alloc_count;
+    size_t free_count;
+    double fragmentation;
+} AllocatorApiStats;
+
+typedef struct AllocatorApi {
+    uint32_t version;
+    uint32_t size;
+    const char* name;
+    void* (*create)(void* memory, size_t size);
+    void (*destroy)(void* allocator);
+    void* (*alloc)(void* allocator, size_t size);
+    void (*free)(void* allocator, void* memory);
+    void* (*realloc)(void* allocator, void* memory, size_t size);
+    void (*stats)(void* allocator, AllocatorApiStats* stats);
+    void* (*aligned_alloc)(void* allocator, size_t alignment, size_t size);
+    int (*validate)(void* allocator);
+} AllocatorApi;
+
+#endif // ALLOCATOR_API_H
@@ -0,0 +1,279 @@
+#define _GNU_SOURCE
+#include "arena.h"
+#include "allocator.h"
+#include "buddy_allocator.h"
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static void* map_chunk(const ArenaOptions* options, size_t size) {
+    void* memory;
+
+    if (options->huge_pages == ARENA_HUGE_EXPLICIT) {
+        memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED) return memory;
+    }
+
+    if (options->huge_pages != ARENA_HUGE_TRANSPARENT) {
+        memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return memory == MAP_FAILED ? NULL : memory;
+    }
+
+    // Transparent huge pages only back 2 MiB aligned ranges: map one huge
+    // page more than needed and trim both ends.
+    size_t padded = size + ARENA_HUGE_PAGE_SIZE;
+    char* raw = mmap(NULL, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return NULL;
+
+    char* start = (char*)align_up((uintptr_t)raw, ARENA_HUGE_PAGE_SIZE);
+    if (start > raw) munmap(raw, (size_t)(start - raw));
+    size_t tail = (size_t)(raw + padded - (start + size));
+    if (tail) munmap(start + size, tail);
+
+    madvise(start, size, MADV_HUGEPAGE);
+    return start;
+}
+
+static void* create_allocator(const Arena* arena, void* memory, size_t size) {
+    if (arena->options.backend == ARENA_BACKEND_BUDDY) {
+        return buddy_allocator_create(memory, size);
+    }
+    return allocator_create(memory, size);
+}
+
+static void* chunk_alloc(const Arena* arena, ArenaChunk* chunk, size_t size) {
+    if (arena->options.backend == ARENA_BACKEND_BUDDY) {
+        return buddy_allocator_alloc(chunk->allocator, size);
+    }
+    return allocator_alloc(chunk->allocator, size);
+}
+
+static void chunk_free(const Arena* arena, ArenaChunk* chunk, void* memory) {
+    if (arena->options.backend == ARENA_BACKEND_BUDDY) {
+        buddy_allocator_free(chunk->allocator, memory);
+    } else {
+        allocator_free(chunk->allocator, memory);
+    }
+}
+
+// Index of the chunk containing `memory`, or chunk_count if there is none.
+static size_t find_chunk(const Arena* arena, const void* memory) {
+    const char* address = memory;
+    size_t low = 0;
+    size_t high = arena->chunk_count;
+
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (arena->chunks[middle].start <= address) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    if (low == 0) return arena->chunk_count;
+    const ArenaChunk* chunk = &arena->chunks[low - 1];
+    return address < chunk->start + chunk->size ? low - 1 : arena->chunk_count;
+}
+
+static size_t add_chunk(Arena* arena, size_t request) {
+    if (arena->chunk_count == ARENA_MAX_CHUNKS || request > SIZE_MAX / 4) return ARENA_MAX_CHUNKS;
+
+    // A buddy chunk needs the whole power-of-two block for the request plus
+    // the metadata buddy_allocator_create lays out in front of it, the free
+    // list only needs room for its own.
+    size_t granularity = arena->options.huge_pages == ARENA_HUGE_NONE ? (size_t)sysconf(_SC_PAGESIZE)
+                                                                       : ARENA_HUGE_PAGE_SIZE;
+    size_t size;
+    if (arena->options.backend == ARENA_BACKEND_BUDDY) {
+        size_t block = (size_t)1 << (64 - __builtin_clzll(request + sizeof(BuddyHeader) - 1));
+        size = buddy_allocator_required_size(block);
+        if (size == 0) return ARENA_MAX_CHUNKS;
+    } else {
+        size = request + sizeof(Allocator) + 4096;
+    }
+    if (size < arena->options.chunk_size) size = arena->options.chunk_size;
+    size = align_up(size, granularity);
+
+    char* memory = map_chunk(&arena->options, size);
+    if (!memory) return ARENA_MAX_CHUNKS;
+
+    void* allocator = create_allocator(arena, memory, size);
+    if (!allocator) {
+        munmap(memory, size);
+        return ARENA_MAX_CHUNKS;
+    }
+
+    size_t index = 0;
+    while (index < arena->chunk_count && arena->chunks[index].start < memory) index++;
+    memmove(&arena->chunks[index + 1], &arena->chunks[index],
+            (arena->chunk_count - index) * sizeof(ArenaChunk));
+    arena->chunk_count++;
+    if (arena->current >= index && arena->chunk_count > 1) arena->current++;
+
+    ArenaChunk* chunk = &arena->chunks[index];
+    chunk->start = memory;
+    chunk->size = size;
+    chunk->allocator = allocator;
+    chunk->live = 0;
+    chunk->decommitted = 0;
+
+    arena->mapped_bytes += size;
+    arena->committed_bytes += size;
+    return index;
+}
+
+static void remove_chunk(Arena* arena, size_t index) {
+    ArenaChunk* chunk = &arena->chunks[index];
+    munmap(chunk->start, chunk->size);
+    arena->mapped_bytes -= chunk->size;
+    if (!chunk->decommitted) arena->committed_bytes -= chunk->size;
+
+    memmove(chunk, chunk + 1, (arena->chunk_count - index - 1) * sizeof(ArenaChunk));
+    arena->chunk_count--;
+    if (arena->current > index) arena->current--;
+    if (arena->current >= arena->chunk_count) arena->current = 0;
+}
+
+static void decommit_chunk(Arena* arena, ArenaChunk* chunk) {
+    madvise(chunk->start, chunk->size, MADV_DONTNEED);
+    chunk->allocator = NULL;
+    chunk->decommitted = 1;
+    arena->committed_bytes -= chunk->size;
+}
+
+// Takes a block from one chunk, bringing a decommitted chunk back first.
+static void* try_chunk(Arena* arena, size_t index, size_t size) {
+    ArenaChunk* chunk = &arena->chunks[index];
+
+    int revived = 0;
+    if (chunk->decommitted) {
+        if (size >= chunk->size) return NULL;
+        chunk->allocator = create_allocator(arena, chunk->start, chunk->size);
+        if (!chunk->allocator) return NULL;
+        chunk->decommitted = 0;
+        arena->committed_bytes += chunk->size;
+        arena->empty_chunks++;
+        revived = 1;
+    }
+
+    void* memory = chunk_alloc(arena, chunk, size);
+    if (!memory) {
+        if (revived) {
+            arena->empty_chunks--;
+            decommit_chunk(arena, chunk);
+        }
+        return NULL;
+    }
+
+    if (chunk->live++ == 0) arena->empty_chunks--;
+    arena->current = index;
+    return memory;
+}
+
+Arena* arena_create(const ArenaOptions* options) {
+    Arena* arena = mmap(NULL, sizeof(Arena), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (arena == MAP_FAILED) return NULL;
+
+    if (options) {
+        arena->options = *options;
+    } else {
+        arena->options = (ArenaOptions){ARENA_BACKEND_FREE_LIST, ARENA_DEFAULT_CHUNK_SIZE, 1, ARENA_HUGE_NONE,
+                                        ARENA_RELEASE_UNMAP};
+    }
+    if (arena->options.chunk_size == 0) arena->options.chunk_size = ARENA_DEFAULT_CHUNK_SIZE;
+
+    arena->chunk_count = 0;
+    arena->current = 0;
+    arena->empty_chunks = 0;
+    arena->mapped_bytes = 0;
+    arena->committed_bytes = 0;
+    return arena;
+}
+
+void arena_destroy(Arena* arena) {
+    if (!arena) return;
+
+    for (size_t i = 0; i < arena->chunk_count; i++) {
+        munmap(arena->chunks[i].start, arena->chunks[i].size);
+    }
+    munmap(arena, sizeof(Arena));
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    if (size == 0) return NULL;
+
+    // The chunk that served the last request is likely to serve this one,
+    // chunks with live blocks are preferred over empty or decommitted ones.
+    if (arena->chunk_count) {
+        void* memory = try_chunk(arena, arena->current, size);
+        if (memory) return memory;
+
+        for (int pass = 0; pass < 2; pass++) {
+            for (size_t i = 0; i < arena->chunk_count; i++) {
+                if (i == arena->current || (arena->chunks[i].live == 0) != pass) continue;
+                memory = try_chunk(arena, i, size);
+                if (memory) return memory;
+            }
+        }
+    }
+
+    size_t index = add_chunk(arena, size);
+    if (index == ARENA_MAX_CHUNKS) return NULL;
+    arena->empty_chunks++;
+
+    void* memory = try_chunk(arena, index, size);
+    if (!memory) {
+        arena->empty_chunks--;
+        remove_chunk(arena, index);
+    }
+    return memory;
+}
+
+void arena_free(Arena* arena, void* memory) {
+    if (!memory) return;
+
+    size_t index = find_chunk(arena, memory);
+    if (index == arena->chunk_count) return;
+
+    ArenaChunk* chunk = &arena->chunks[index];
+    chunk_free(arena, chunk, memory);
+    if (--chunk->live > 0) return;
+
+    if (++arena->empty_chunks <= arena->options.retain_chunks) return;
+
+    arena->empty_chunks--;
+    if (arena->options.release == ARENA_RELEASE_DECOMMIT) {
+        decommit_chunk(arena, chunk);
+    } else {
+        remove_chunk(arena, index);
+    }
+}
+
+size_t arena_usable_size(const Arena* arena, const void* memory) {
+    size_t index = find_chunk(arena, memory);
+    if (index == arena->chunk_count) return 0;
+
+    const ArenaChunk* chunk = &arena->chunks[index];
+    if (arena->options.backend == ARENA_BACKEND_BUDDY) {
+        return buddy_allocator_usable_size(chunk->allocator, memory);
+    }
+    return allocator_usable_size(chunk->allocator, memory);
+}
+
+int arena_owns(const Arena* arena, const void* memory) {
+    return find_chunk(arena, memory) != arena->chunk_count;
+}
+
+size_t arena_mapped_bytes(const Arena* arena) {
+    return arena->mapped_bytes;
+}
+
+size_t arena_committed_bytes(const Arena* arena) {
+    return arena->committed_bytes;
+}
@@ -0,0 +1,69 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_DEFAULT_CHUNK_SIZE ((size_t)4 << 20)
+#define ARENA_HUGE_PAGE_SIZE ((size_t)2 << 20)
+#define ARENA_MAX_CHUNKS 1024
+
+typedef enum ArenaBackend {
+    ARENA_BACKEND_FREE_LIST,
+    ARENA_BACKEND_BUDDY
+} ArenaBackend;
+
+typedef enum ArenaHugePages {
+    ARENA_HUGE_NONE,
+    ARENA_HUGE_TRANSPARENT,  // madvise(MADV_HUGEPAGE) on 2 MiB aligned chunks
+    ARENA_HUGE_EXPLICIT      // MAP_HUGETLB, falls back to normal pages
+} ArenaHugePages;
+
+// What happens to a chunk that became fully free once `retain_chunks`
+// empty chunks are already kept warm.
+typedef enum ArenaRelease {
+    ARENA_RELEASE_UNMAP,     // munmap, address space is returned as well
+    ARENA_RELEASE_DECOMMIT   // madvise(MADV_DONTNEED), the mapping is reused
+} ArenaRelease;
+
+typedef struct ArenaOptions {
+    ArenaBackend backend;
+    size_t chunk_size;
+    size_t retain_chunks;
+    ArenaHugePages huge_pages;
+    ArenaRelease release;
+} ArenaOptions;
+
+// One mmap'd region managed by its own allocator. `live` counts blocks
+// handed out from it, a decommitted chunk gets a fresh allocator on reuse.
+typedef struct ArenaChunk {
+    char* start;
+    size_t size;
+    void* allocator;
+    size_t live;
+    int decommitted;
+} ArenaChunk;
+
+// Chunks are kept sorted by address so the owner of a block is found by
+// binary search; `current` is the chunk that served the last allocation.
+typedef struct Arena {
+    ArenaOptions options;
+    size_t chunk_count;
+    size_t current;
+    size_t empty_chunks;
+    size_t mapped_bytes;
+    size_t committed_bytes;
+    ArenaChunk chunks[ARENA_MAX_CHUNKS];
+} Arena;
+
+// `options` may be NULL for a free-list arena with default settings.
+Arena* arena_create(const ArenaOptions* options);
+void arena_destroy(Arena* arena);
+void* arena_alloc(Arena* arena, size_t size);
+void arena_free(Arena* arena, void* memory);
+size_t arena_usable_size(const Arena* arena, const void* memory);
+int arena_owns(const Arena* arena, const void* memory);
+
+size_t arena_mapped_bytes(const Arena* arena);
+size_t arena_committed_bytes(const Arena* arena);
+
+#endif // ARENA_H
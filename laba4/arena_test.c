@@ -0,0 +1,76 @@
+#include "arena.h"
+#include "buddy_allocator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#define MIB ((size_t)1 << 20)
+
+static int failures = 0;
+
+static void check(int condition, const char* what) {
+    if (condition) return;
+    fprintf(stderr, "ОШИБКА: %s\n", what);
+    failures++;
+}
+
+// A chunk sized by buddy_allocator_required_size must hold a whole block
+// of that size, for every order up to past LARGE_ARENA_SIZE where the
+// minimum order changes.
+static void test_required_size(void) {
+    for (size_t order = MIN_BUDDY_ORDER; order <= 31; order++) {
+        size_t block = (size_t)1 << order;
+        size_t size = buddy_allocator_required_size(block);
+        char* memory = mmap(NULL, size + 8, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (memory == MAP_FAILED) {
+            check(0, "mmap под арену");
+            continue;
+        }
+
+        // Odd start: the base alignment must come out of the slack too.
+        BuddyAllocator* allocator = buddy_allocator_create(memory + 8, size);
+        check(allocator && allocator->memory_size >= block, "арена меньше запрошенного блока");
+        if (allocator) {
+            void* whole = buddy_allocator_alloc(allocator, block - sizeof(BuddyHeader));
+            check(whole != NULL, "блок размером с арену не выделился");
+            buddy_allocator_free(allocator, whole);
+            check(buddy_allocator_validate(allocator) == 0, "куча повреждена");
+        }
+        munmap(memory, size + 8);
+    }
+}
+
+static void test_large_buddy_blocks(void) {
+    ArenaOptions options = {ARENA_BACKEND_BUDDY, ARENA_DEFAULT_CHUNK_SIZE, 1, ARENA_HUGE_NONE,
+                            ARENA_RELEASE_UNMAP};
+    Arena* arena = arena_create(&options);
+    check(arena != NULL, "арена не создана");
+    if (!arena) return;
+
+    const size_t sizes[] = {64 * MIB, 64 * MIB - 100, 256 * MIB, 100 * MIB};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        char* memory = arena_alloc(arena, sizes[i]);
+        check(memory != NULL, "большой блок не выделился");
+        if (!memory) continue;
+
+        memory[0] = 1;
+        memory[sizes[i] - 1] = 1;
+        check(arena_usable_size(arena, memory) >= sizes[i], "полезный размер меньше запрошенного");
+        check(arena_mapped_bytes(arena) >= sizes[i], "отображено меньше запрошенного");
+        arena_free(arena, memory);
+    }
+
+    arena_destroy(arena);
+}
+
+int main(void) {
+    test_required_size();
+    test_large_buddy_blocks();
+
+    if (failures) {
+        fprintf(stderr, "Ошибок: %d\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("Все проверки пройдены\n");
+    return EXIT_SUCCESS;
+}
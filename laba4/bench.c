@@ -0,0 +1,1494 @@
+#include "allocator.h"
+#include "allocator_api.h"
+#include "arena.h"
+#include "buddy_allocator.h"
+#include "concurrent_allocator.h"
+#include "region_allocator.h"
+#include "shm_allocator.h"
+#include "slab_allocator.h"
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ARENA_SIZE ((size_t)256 << 20)
+#define WINDOW 64
+#define SHARED_SLOTS 1024
+#define SLAB_ARENA_SIZE ((size_t)4 << 20)
+#define SUITE_ARENA_SIZE ((size_t)64 << 20)
+#define LATENCY_SAMPLE_EVERY 64
+#define SHM_SEGMENT_NAME "/laba4_bench_shm"
+#define SHM_SEGMENT_SIZE ((size_t)16 << 20)
+#define SHM_QUEUE_SLOTS 256
+#define SHM_FIXED_SLOT 4096
+#define SCRATCH_MAX_TEMPORARIES 8
+
+typedef struct BenchAllocator {
+    const char* name;
+    void* (*alloc)(void* state, size_t size);
+    void (*free)(void* state, void* memory);
+    void* state;
+    size_t (*free_bytes)(void* state);
+} BenchAllocator;
+
+typedef struct Object {
+    int id;
+    char name[50];
+    float value;
+} Object;
+
+typedef enum EventOp {
+    EVENT_ALLOC,
+    EVENT_FREE
+} EventOp;
+
+// Workloads are expanded into an event list up front, so every allocator
+// replays exactly the same sequence and generation is not timed.
+typedef struct Event {
+    uint32_t op;
+    uint32_t slot;
+    size_t size;
+} Event;
+
+typedef struct EventList {
+    Event* events;
+    size_t count;
+    size_t capacity;
+    size_t slots;
+} EventList;
+
+typedef struct SuiteResult {
+    double ops_per_second;
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t p999;
+    size_t peak_live;
+    size_t peak_footprint;
+    double fragmentation;
+    size_t failures;
+} SuiteResult;
+
+typedef struct PluginAllocator {
+    const AllocatorApi* api;
+    void* allocator;
+} PluginAllocator;
+
+// Lives in the shared segment, published through the allocator root.
+// In offset mode `messages` carries offsets of exactly sized ShmMessage
+// blocks, in fixed mode messages are copied into 4 KiB slots at `slots`
+// the way laba3 does it.
+typedef struct ShmQueue {
+    sem_t items;
+    sem_t free_slots;
+    uint32_t head;
+    uint32_t tail;
+    int fixed;
+    ShmOffset slots;
+    ShmOffset messages[SHM_QUEUE_SLOTS];
+} ShmQueue;
+
+typedef struct ShmMessage {
+    uint32_t length;
+    uint32_t checksum;
+    unsigned char data[];
+} ShmMessage;
+
+typedef struct LockedAllocator {
+    pthread_mutex_t lock;
+    Allocator* allocator;
+} LockedAllocator;
+
+typedef enum Workload {
+    WORKLOAD_LOCAL,
+    WORKLOAD_SHUFFLE
+} Workload;
+
+typedef struct ThreadArgs {
+    const BenchAllocator* allocator;
+    Workload workload;
+    size_t ops;
+    uint64_t seed;
+    void** slots;
+    pthread_barrier_t* barrier;
+    size_t failures;
+} ThreadArgs;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t xorshift(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+static void* concurrent_alloc(void* state, size_t size) {
+    return concurrent_allocator_alloc(state, size);
+}
+
+static void concurrent_free(void* state, void* memory) {
+    concurrent_allocator_free(state, memory);
+}
+
+static void* locked_alloc(void* state, size_t size) {
+    LockedAllocator* locked = state;
+    pthread_mutex_lock(&locked->lock);
+    void* memory = allocator_alloc(locked->allocator, size);
+    pthread_mutex_unlock(&locked->lock);
+    return memory;
+}
+
+static void locked_free(void* state, void* memory) {
+    LockedAllocator* locked = state;
+    pthread_mutex_lock(&locked->lock);
+    allocator_free(locked->allocator, memory);
+    pthread_mutex_unlock(&locked->lock);
+}
+
+static void* list_alloc(void* state, size_t size) {
+    return allocator_alloc(state, size);
+}
+
+static void list_free(void* state, void* memory) {
+    allocator_free(state, memory);
+}
+
+static size_t list_free_bytes(void* state) {
+    return allocator_free_bytes(state);
+}
+
+static void* buddy_alloc(void* state, size_t size) {
+    return buddy_allocator_alloc(state, size);
+}
+
+static void buddy_free(void* state, void* memory) {
+    buddy_allocator_free(state, memory);
+}
+
+static size_t buddy_free_bytes(void* state) {
+    return buddy_allocator_free_bytes(state);
+}
+
+static void* slab_alloc(void* state, size_t size) {
+    (void)size;
+    return slab_cache_alloc(state);
+}
+
+static void slab_free(void* state, void* memory) {
+    slab_cache_free(state, memory);
+}
+
+static size_t slab_free_bytes(void* state) {
+    return slab_allocator_free_bytes(((SlabCache*)state)->owner);
+}
+
+static void* plugin_alloc(void* state, size_t size) {
+    PluginAllocator* plugin = state;
+    return plugin->api->alloc(plugin->allocator, size);
+}
+
+static void plugin_free(void* state, void* memory) {
+    PluginAllocator* plugin = state;
+    plugin->api->free(plugin->allocator, memory);
+}
+
+static size_t plugin_free_bytes(void* state) {
+    PluginAllocator* plugin = state;
+    AllocatorApiStats stats;
+    plugin->api->stats(plugin->allocator, &stats);
+    return stats.free_bytes;
+}
+
+static void* system_alloc(void* state, size_t size) {
+    (void)state;
+    return malloc(size);
+}
+
+static void system_free(void* state, void* memory) {
+    (void)state;
+    free(memory);
+}
+
+static void* thread_worker(void* raw) {
+    ThreadArgs* args = raw;
+    const BenchAllocator* allocator = args->allocator;
+    void* window[WINDOW] = {0};
+    uint64_t rng = args->seed;
+
+    pthread_barrier_wait(args->barrier);
+
+    for (size_t i = 0; i < args->ops; i++) {
+        uint64_t r = xorshift(&rng);
+        size_t size = 16 + (size_t)(r % 240);
+        void* memory = allocator->alloc(allocator->state, size);
+        if (!memory) {
+            args->failures++;
+            continue;
+        }
+        memset(memory, (int)r, 16);
+
+        // Shuffle hands blocks to whichever thread next picks the slot,
+        // so most frees land on a cache owned by another thread.
+        void** slot = args->workload == WORKLOAD_SHUFFLE
+                          ? &args->slots[(r >> 32) % SHARED_SLOTS]
+                          : &window[(r >> 32) % WINDOW];
+        void* old = __atomic_exchange_n(slot, memory, __ATOMIC_ACQ_REL);
+        if (old) allocator->free(allocator->state, old);
+    }
+
+    for (size_t i = 0; i < WINDOW; i++) {
+        if (window[i]) allocator->free(allocator->state, window[i]);
+    }
+    return NULL;
+}
+
+static double run_threads(const BenchAllocator* allocator, Workload workload, int threads,
+                          size_t ops, size_t* failures) {
+    pthread_t ids[threads];
+    ThreadArgs args[threads];
+    void** slots = calloc(SHARED_SLOTS, sizeof(void*));
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, (unsigned)threads + 1);
+
+    for (int t = 0; t < threads; t++) {
+        args[t] = (ThreadArgs){allocator, workload, ops, 0x9E3779B97F4A7C15ull * (uint64_t)(t + 1),
+                               slots, &barrier, 0};
+        pthread_create(&ids[t], NULL, thread_worker, &args[t]);
+    }
+
+    pthread_barrier_wait(&barrier);
+    double start = now_seconds();
+    for (int t = 0; t < threads; t++) {
+        pthread_join(ids[t], NULL);
+    }
+    double elapsed = now_seconds() - start;
+
+    *failures = 0;
+    for (int t = 0; t < threads; t++) {
+        *failures += args[t].failures;
+    }
+    for (size_t i = 0; i < SHARED_SLOTS; i++) {
+        if (slots[i]) allocator->free(allocator->state, slots[i]);
+    }
+
+    pthread_barrier_destroy(&barrier);
+    free(slots);
+    return (double)(ops * (size_t)threads) / elapsed;
+}
+
+static int bench_threads(int max_threads, size_t ops) {
+    char* memory = malloc(ARENA_SIZE);
+    char* locked_memory = malloc(ARENA_SIZE);
+    if (!memory || !locked_memory) {
+        fprintf(stderr, "Не удалось выделить арену\n");
+        return EXIT_FAILURE;
+    }
+
+    static const char* const workload_names[] = {"local", "shuffle"};
+    printf("%-22s %-8s %7s %12s %12s %9s\n", "allocator", "workload", "threads", "ops/s",
+           "ops/s/thread", "failures");
+
+    for (int workload = WORKLOAD_LOCAL; workload <= WORKLOAD_SHUFFLE; workload++) {
+        for (int variant = 0; variant < 4; variant++) {
+            for (int threads = 1; threads <= max_threads; threads *= 2) {
+                BenchAllocator allocator;
+                LockedAllocator locked;
+
+                // Fresh arenas per run, so earlier runs leave no cached state.
+                switch (variant) {
+                    case 0:
+                        allocator = (BenchAllocator){"concurrent/free-list", concurrent_alloc, concurrent_free,
+                                                     concurrent_allocator_create(memory, ARENA_SIZE,
+                                                                                 CONCURRENT_BACKEND_FREE_LIST), NULL};
+                        break;
+                    case 1:
+                        allocator = (BenchAllocator){"concurrent/buddy", concurrent_alloc, concurrent_free,
+                                                     concurrent_allocator_create(memory, ARENA_SIZE,
+                                                                                 CONCURRENT_BACKEND_BUDDY), NULL};
+                        break;
+                    case 2:
+                        pthread_mutex_init(&locked.lock, NULL);
+                        locked.allocator = allocator_create(locked_memory, ARENA_SIZE);
+                        allocator = (BenchAllocator){"global-lock/free-list", locked_alloc, locked_free, &locked, NULL};
+                        break;
+                    default:
+                        allocator = (BenchAllocator){"malloc", system_alloc, system_free, NULL, NULL};
+                        break;
+                }
+
+                size_t failures;
+                double rate = run_threads(&allocator, (Workload)workload, threads, ops, &failures);
+                printf("%-22s %-8s %7d %12.0f %12.0f %9zu\n", allocator.name, workload_names[workload],
+                       threads, rate, rate / threads, failures);
+
+                if (variant < 2) concurrent_allocator_destroy(allocator.state);
+                if (variant == 2) pthread_mutex_destroy(&locked.lock);
+            }
+        }
+    }
+
+    free(memory);
+    free(locked_memory);
+    return EXIT_SUCCESS;
+}
+
+static int bench_slab(size_t count, size_t ops) {
+    char* memory = malloc(SLAB_ARENA_SIZE);
+    void** objects = calloc(count, sizeof(void*));
+    if (!memory || !objects) {
+        fprintf(stderr, "Не удалось выделить арену\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("%-10s %8s %10s %14s %12s\n", "allocator", "objects", "fitted", "bytes/object", "ops/s");
+
+    for (int variant = 0; variant < 3; variant++) {
+        BenchAllocator allocator;
+        switch (variant) {
+            case 0:
+                allocator = (BenchAllocator){"free-list", list_alloc, list_free,
+                                             allocator_create(memory, SLAB_ARENA_SIZE), list_free_bytes};
+                break;
+            case 1:
+                allocator = (BenchAllocator){"buddy", buddy_alloc, buddy_free,
+                                             buddy_allocator_create(memory, SLAB_ARENA_SIZE), buddy_free_bytes};
+                break;
+            default:
+                allocator = (BenchAllocator){"slab", slab_alloc, slab_free,
+                                             slab_cache_create(slab_allocator_create(memory, SLAB_ARENA_SIZE),
+                                                               sizeof(Object)),
+                                             slab_free_bytes};
+                break;
+        }
+
+        size_t before = allocator.free_bytes(allocator.state);
+        size_t fitted = 0;
+        for (size_t i = 0; i < count; i++) {
+            objects[i] = allocator.alloc(allocator.state, sizeof(Object));
+            if (objects[i]) fitted++;
+        }
+        size_t used = before - allocator.free_bytes(allocator.state);
+
+        uint64_t rng = 88172645463325252ull;
+        double start = now_seconds();
+        for (size_t i = 0; i < ops; i++) {
+            size_t index = (size_t)(xorshift(&rng) % count);
+            allocator.free(allocator.state, objects[index]);
+            objects[index] = allocator.alloc(allocator.state, sizeof(Object));
+            if (objects[index]) ((Object*)objects[index])->id = (int)i;
+        }
+        double elapsed = now_seconds() - start;
+
+        for (size_t i = 0; i < count; i++) {
+            allocator.free(allocator.state, objects[i]);
+        }
+
+        printf("%-10s %8zu %10zu %14.1f %12.0f\n", allocator.name, count, fitted,
+               fitted ? (double)used / (double)fitted : 0.0, (double)(2 * ops) / elapsed);
+    }
+
+    printf("sizeof(Object) = %zu\n", sizeof(Object));
+    free(objects);
+    free(memory);
+    return EXIT_SUCCESS;
+}
+
+static void push_event(EventList* list, EventOp op, uint32_t slot, size_t size) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 4096;
+        list->events = realloc(list->events, list->capacity * sizeof(Event));
+        if (!list->events) {
+            fprintf(stderr, "Не удалось выделить память под события\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    list->events[list->count++] = (Event){op, slot, size};
+    if (slot + 1 > list->slots) list->slots = slot + 1;
+}
+
+static size_t uniform_size(uint64_t* rng) {
+    return 16 + (size_t)(xorshift(rng) % 4081);
+}
+
+// Geometric choice of the power of two, uniform inside it: sizes from
+// 16 bytes to 32 KiB with a heavy tail, like typical malloc traces.
+static size_t power_law_size(uint64_t* rng) {
+    uint64_t r = xorshift(rng);
+    unsigned bits = (unsigned)__builtin_ctzll(r | (1ull << 11));
+    size_t base = (size_t)16 << bits;
+    return base + (size_t)((r >> 32) % base);
+}
+
+static void generate_random(EventList* list, size_t ops, size_t (*size_of)(uint64_t*)) {
+    const uint32_t window = 4096;
+    uint8_t* live = calloc(window, 1);
+    uint64_t rng = 0x2545F4914F6CDD1Dull;
+
+    for (size_t i = 0; i < ops; i++) {
+        uint32_t slot = (uint32_t)(xorshift(&rng) % window);
+        if (live[slot]) push_event(list, EVENT_FREE, slot, 0);
+        push_event(list, EVENT_ALLOC, slot, size_of(&rng));
+        live[slot] = 1;
+    }
+    for (uint32_t slot = 0; slot < window; slot++) {
+        if (live[slot]) push_event(list, EVENT_FREE, slot, 0);
+    }
+    free(live);
+}
+
+// A single-threaded message queue with bursty production: messages are
+// freed oldest first once the backlog passes a moving bound.
+static void generate_producer_consumer(EventList* list, size_t ops) {
+    const uint32_t capacity = 8192;
+    uint64_t rng = 0x9E3779B97F4A7C15ull;
+    uint32_t head = 0, tail = 0;
+
+    for (size_t i = 0; i < ops; i++) {
+        push_event(list, EVENT_ALLOC, tail % capacity, 64 + (size_t)(xorshift(&rng) % 961));
+        tail++;
+
+        uint32_t bound = 64 + (uint32_t)(xorshift(&rng) % 2048);
+        while (tail - head > bound) {
+            push_event(list, EVENT_FREE, head % capacity, 0);
+            head++;
+        }
+    }
+    while (head != tail) {
+        push_event(list, EVENT_FREE, head % capacity, 0);
+        head++;
+    }
+}
+
+static void generate_lifo(EventList* list, size_t ops) {
+    uint64_t rng = 0xD1B54A32D192ED03ull;
+    size_t done = 0;
+
+    while (done < ops) {
+        uint32_t depth = 1 + (uint32_t)(xorshift(&rng) % 4096);
+        for (uint32_t slot = 0; slot < depth; slot++) {
+            push_event(list, EVENT_ALLOC, slot, uniform_size(&rng));
+        }
+        for (uint32_t slot = depth; slot-- > 0;) {
+            push_event(list, EVENT_FREE, slot, 0);
+        }
+        done += depth;
+    }
+}
+
+static void generate_fifo(EventList* list, size_t ops) {
+    const uint32_t capacity = 4096;
+    uint64_t rng = 0xA0761D6478BD642Full;
+
+    for (uint32_t slot = 0; slot < capacity; slot++) {
+        push_event(list, EVENT_ALLOC, slot, uniform_size(&rng));
+    }
+    for (size_t i = 0; i < ops; i++) {
+        uint32_t slot = (uint32_t)(i % capacity);
+        push_event(list, EVENT_FREE, slot, 0);
+        push_event(list, EVENT_ALLOC, slot, uniform_size(&rng));
+    }
+    for (uint32_t slot = 0; slot < capacity; slot++) {
+        push_event(list, EVENT_FREE, slot, 0);
+    }
+}
+
+// Trace lines: "a <id> <size>", "f <id>" and "r <id> <size>" (realloc,
+// replayed as free + alloc). Ids may be any 64-bit value such as a
+// pointer printed in hex, lines starting with '#' are ignored.
+static int load_trace(EventList* list, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return -1;
+    }
+
+    size_t map_capacity = 1 << 16;
+    uint64_t* keys = calloc(map_capacity, sizeof(uint64_t));
+    uint32_t* values = calloc(map_capacity, sizeof(uint32_t));
+    uint32_t* free_slots = NULL;
+    size_t free_count = 0, free_capacity = 0, map_count = 0;
+    uint32_t next_slot = 0;
+    if (!keys || !values) {
+        fprintf(stderr, "Не удалось выделить память под трассу\n");
+        fclose(file);
+        free(keys);
+        free(values);
+        return -1;
+    }
+
+    char line[256];
+    size_t line_number = 0;
+    int status = 0;
+
+    while (status == 0 && fgets(line, sizeof(line), file)) {
+        line_number++;
+        char op;
+        unsigned long long id;
+        size_t size = 0;
+        if (line[0] == '#' || line[0] == '\n') continue;
+        int fields = sscanf(line, " %c %lli %zu", &op, &id, &size);
+        if (fields < 2 || (op != 'f' && (fields < 3 || size == 0)) || (op != 'a' && op != 'f' && op != 'r')) {
+            fprintf(stderr, "%s:%zu: неверная строка трассы\n", path, line_number);
+            status = -1;
+            break;
+        }
+
+        // Open addressing keyed by id + 1, so zero marks an empty bucket.
+        uint64_t key = (uint64_t)id + 1;
+        size_t bucket = (size_t)(key * 0x9E3779B97F4A7C15ull) & (map_capacity - 1);
+        while (keys[bucket] && keys[bucket] != key) bucket = (bucket + 1) & (map_capacity - 1);
+
+        if (op != 'a' && keys[bucket] == key) {
+            uint32_t slot = values[bucket];
+            push_event(list, EVENT_FREE, slot, 0);
+            if (op == 'r') {
+                push_event(list, EVENT_ALLOC, slot, size);
+                continue;
+            }
+
+            if (free_count == free_capacity) {
+                size_t capacity = free_capacity ? free_capacity * 2 : 1024;
+                uint32_t* grown = realloc(free_slots, capacity * sizeof(uint32_t));
+                if (!grown) {
+                    fprintf(stderr, "Не удалось выделить память под трассу\n");
+                    status = -1;
+                    break;
+                }
+                free_slots = grown;
+                free_capacity = capacity;
+            }
+            free_slots[free_count++] = slot;
+
+            // Backward-shift deletion keeps probe chains intact.
+            size_t hole = bucket;
+            size_t next = (hole + 1) & (map_capacity - 1);
+            while (keys[next]) {
+                size_t home = (size_t)(keys[next] * 0x9E3779B97F4A7C15ull) & (map_capacity - 1);
+                if (((next - home) & (map_capacity - 1)) >= ((next - hole) & (map_capacity - 1))) {
+                    keys[hole] = keys[next];
+                    values[hole] = values[next];
+                    hole = next;
+                }
+                next = (next + 1) & (map_capacity - 1);
+            }
+            keys[hole] = 0;
+            map_count--;
+            continue;
+        }
+        if (op == 'f') continue;
+        if (keys[bucket] == key) {
+            fprintf(stderr, "%s:%zu: повторное выделение id\n", path, line_number);
+            status = -1;
+            break;
+        }
+
+        uint32_t slot = free_count ? free_slots[--free_count] : next_slot++;
+        keys[bucket] = key;
+        values[bucket] = slot;
+        push_event(list, EVENT_ALLOC, slot, size);
+
+        if (++map_count * 2 > map_capacity) {
+            size_t old_capacity = map_capacity;
+            uint64_t* old_keys = keys;
+            uint32_t* old_values = values;
+            map_capacity *= 2;
+            keys = calloc(map_capacity, sizeof(uint64_t));
+            values = calloc(map_capacity, sizeof(uint32_t));
+            if (!keys || !values) {
+                free(old_keys);
+                free(old_values);
+                fprintf(stderr, "Не удалось выделить память под трассу\n");
+                status = -1;
+                break;
+            }
+            for (size_t i = 0; i < old_capacity; i++) {
+                if (!old_keys[i]) continue;
+                size_t b = (size_t)(old_keys[i] * 0x9E3779B97F4A7C15ull) & (map_capacity - 1);
+                while (keys[b]) b = (b + 1) & (map_capacity - 1);
+                keys[b] = old_keys[i];
+                values[b] = old_values[i];
+            }
+            free(old_keys);
+            free(old_values);
+        }
+    }
+
+    fclose(file);
+    free(keys);
+    free(values);
+    free(free_slots);
+    return status;
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Fresh anonymous mapping per run, so mincore afterwards tells exactly
+// which pages the allocator touched.
+static char* map_arena(size_t size) {
+    char* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        fprintf(stderr, "Не удалось выделить арену\n");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+static size_t touched_bytes(char* memory, size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t pages = (size + page - 1) / page;
+    unsigned char* vector = malloc(pages);
+    if (!vector || mincore(memory, size, vector) != 0) {
+        free(vector);
+        return 0;
+    }
+
+    size_t resident = 0;
+    for (size_t i = 0; i < pages; i++) resident += vector[i] & 1;
+    free(vector);
+    return resident * page;
+}
+
+// Arena allocators are measured by the pages they touched in `arena`
+// (never released during a run, so this is the peak), malloc by the
+// usable size plus chunk header of its live blocks.
+static SuiteResult replay(const BenchAllocator* allocator, char* arena, size_t arena_size, const EventList* list) {
+    SuiteResult result = {0};
+    void** pointers = calloc(list->slots, sizeof(void*));
+    size_t* sizes = calloc(list->slots, sizeof(size_t));
+    size_t sample_count = list->count / LATENCY_SAMPLE_EVERY + 1;
+    uint64_t* samples = malloc(sample_count * sizeof(uint64_t));
+    size_t samples_taken = 0;
+    size_t live = 0;
+    size_t held = 0;
+
+    double start = now_seconds();
+    for (size_t i = 0; i < list->count; i++) {
+        const Event* event = &list->events[i];
+        int timed = i % LATENCY_SAMPLE_EVERY == 0;
+        uint64_t begin = timed ? now_ns() : 0;
+
+        if (event->op == EVENT_ALLOC) {
+            char* memory = allocator->alloc(allocator->state, event->size);
+            if (memory) {
+                // One write per page, as a program filling the block would.
+                for (size_t offset = 0; offset < event->size; offset += 4096) memory[offset] = 1;
+                memory[event->size - 1] = 1;
+                live += event->size;
+                sizes[event->slot] = event->size;
+                if (!arena) {
+                    held += malloc_usable_size(memory) + sizeof(size_t);
+                    if (held > result.peak_footprint) result.peak_footprint = held;
+                }
+            } else {
+                result.failures++;
+            }
+            pointers[event->slot] = memory;
+        } else if (pointers[event->slot]) {
+            if (!arena) held -= malloc_usable_size(pointers[event->slot]) + sizeof(size_t);
+            allocator->free(allocator->state, pointers[event->slot]);
+            pointers[event->slot] = NULL;
+            live -= sizes[event->slot];
+        }
+
+        if (timed) samples[samples_taken++] = now_ns() - begin;
+        if (live > result.peak_live) result.peak_live = live;
+    }
+    double elapsed = now_seconds() - start;
+    if (arena) result.peak_footprint = touched_bytes(arena, arena_size);
+
+    for (size_t slot = 0; slot < list->slots; slot++) {
+        if (pointers[slot]) allocator->free(allocator->state, pointers[slot]);
+    }
+
+    qsort(samples, samples_taken, sizeof(uint64_t), compare_u64);
+    if (samples_taken) {
+        result.p50 = samples[samples_taken / 2];
+        result.p99 = samples[samples_taken * 99 / 100];
+        result.p999 = samples[samples_taken * 999 / 1000];
+    }
+    result.ops_per_second = (double)list->count / elapsed;
+    if (result.peak_footprint > result.peak_live) {
+        result.fragmentation = 1.0 - (double)result.peak_live / (double)result.peak_footprint;
+    }
+
+    free(samples);
+    free(sizes);
+    free(pointers);
+    return result;
+}
+
+static void print_suite_row(const char* workload, const char* name, size_t events, const SuiteResult* result) {
+    printf("%-12s %-10s %10zu %12.0f %8llu %8llu %8llu %11zu %11zu %6.3f %9zu\n", workload, name, events,
+           result->ops_per_second, (unsigned long long)result->p50, (unsigned long long)result->p99,
+           (unsigned long long)result->p999, result->peak_live, result->peak_footprint, result->fragmentation,
+           result->failures);
+}
+
+static void run_suite(const char* workload, const EventList* list) {
+    for (int variant = 0; variant < 3; variant++) {
+        BenchAllocator allocator;
+        char* arena = variant < 2 ? map_arena(SUITE_ARENA_SIZE) : NULL;
+
+        switch (variant) {
+            case 0:
+                allocator = (BenchAllocator){"free-list", list_alloc, list_free,
+                                             allocator_create(arena, SUITE_ARENA_SIZE), list_free_bytes};
+                break;
+            case 1:
+                allocator = (BenchAllocator){"buddy", buddy_alloc, buddy_free,
+                                             buddy_allocator_create(arena, SUITE_ARENA_SIZE), buddy_free_bytes};
+                break;
+            default:
+                allocator = (BenchAllocator){"malloc", system_alloc, system_free, NULL, NULL};
+                break;
+        }
+
+        SuiteResult result = replay(&allocator, arena, SUITE_ARENA_SIZE, list);
+        print_suite_row(workload, allocator.name, list->count, &result);
+        if (arena) munmap(arena, SUITE_ARENA_SIZE);
+    }
+}
+
+static void print_suite_header(void) {
+    printf("%-12s %-10s %10s %12s %8s %8s %8s %11s %11s %6s %9s\n", "workload", "allocator", "events",
+           "ops/s", "p50(ns)", "p99(ns)", "p999(ns)", "peak_live", "peak_fp", "frag", "failures");
+}
+
+static const char* const workload_names[] = {"uniform", "powerlaw", "prodcons", "lifo", "fifo"};
+#define WORKLOAD_COUNT 5
+
+static void generate_workload(EventList* list, int workload, size_t ops) {
+    switch (workload) {
+        case 0: generate_random(list, ops, uniform_size); break;
+        case 1: generate_random(list, ops, power_law_size); break;
+        case 2: generate_producer_consumer(list, ops); break;
+        case 3: generate_lifo(list, ops); break;
+        default: generate_fifo(list, ops); break;
+    }
+}
+
+static int bench_workload(const char* name, size_t ops) {
+    int matched = 0;
+
+    print_suite_header();
+    for (int i = 0; i < WORKLOAD_COUNT; i++) {
+        if (strcmp(name, "all") != 0 && strcmp(name, workload_names[i]) != 0) continue;
+        matched = 1;
+
+        EventList list = {0};
+        generate_workload(&list, i, ops);
+        run_suite(workload_names[i], &list);
+        free(list.events);
+    }
+
+    return matched ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Runs the workloads against any library exporting ALLOCATOR_API_SYMBOL,
+// so a new allocator is benchmarked without relinking laba4_bench.
+static int bench_plugin(const char* path, const char* name, size_t ops) {
+    void* library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!library) {
+        fprintf(stderr, "Ошибка загрузки библиотеки %s: %s\n", path, dlerror());
+        return EXIT_FAILURE;
+    }
+
+    const AllocatorApi* api = dlsym(library, ALLOCATOR_API_SYMBOL);
+    if (!api || api->version != ALLOCATOR_API_VERSION || api->size < sizeof(AllocatorApi)) {
+        fprintf(stderr, "%s: нет совместимого %s\n", path, ALLOCATOR_API_SYMBOL);
+        dlclose(library);
+        return EXIT_FAILURE;
+    }
+
+    int matched = 0;
+    print_suite_header();
+    for (int i = 0; i < WORKLOAD_COUNT; i++) {
+        if (strcmp(name, "all") != 0 && strcmp(name, workload_names[i]) != 0) continue;
+        matched = 1;
+
+        EventList list = {0};
+        generate_workload(&list, i, ops);
+
+        char* memory = map_arena(SUITE_ARENA_SIZE);
+        PluginAllocator plugin = {api, api->create(memory, SUITE_ARENA_SIZE)};
+        if (!plugin.allocator) {
+            fprintf(stderr, "%s: не удалось создать аллокатор\n", api->name);
+            munmap(memory, SUITE_ARENA_SIZE);
+            free(list.events);
+            dlclose(library);
+            return EXIT_FAILURE;
+        }
+        BenchAllocator allocator = {api->name, plugin_alloc, plugin_free, &plugin, plugin_free_bytes};
+
+        SuiteResult result = replay(&allocator, memory, SUITE_ARENA_SIZE, &list);
+        print_suite_row(workload_names[i], allocator.name, list.count, &result);
+
+        api->destroy(plugin.allocator);
+        munmap(memory, SUITE_ARENA_SIZE);
+        free(list.events);
+    }
+
+    dlclose(library);
+    return matched ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int bench_replay(const char* path) {
+    EventList list = {0};
+    if (load_trace(&list, path) != 0) {
+        free(list.events);
+        return EXIT_FAILURE;
+    }
+
+    print_suite_header();
+    run_suite("trace", &list);
+    free(list.events);
+    return EXIT_SUCCESS;
+}
+
+static size_t resident_bytes(void) {
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (!file) return 0;
+
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    if (fscanf(file, "%lu %lu", &size, &resident) != 2) resident = 0;
+    fclose(file);
+    return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+static void print_arena_row(const char* variant, const char* phase, size_t live, const Arena* arena,
+                            size_t baseline) {
+    size_t resident = resident_bytes();
+    printf("%-10s %-8s %12zu %12zu %12zu %12zu\n", variant, phase, live, arena_mapped_bytes(arena),
+           arena_committed_bytes(arena), resident > baseline ? resident - baseline : 0);
+}
+
+// Grows a chunked arena to `count` live blocks, frees all but the oldest
+// 1/32 and repeats, showing how much memory each release policy hands
+// back. A survivor pins its whole chunk, so scattered survivors would
+// keep every chunk alive whatever the policy.
+static int bench_arena(size_t count, int rounds) {
+    void** objects = calloc(count, sizeof(void*));
+    if (!objects) {
+        fprintf(stderr, "Не удалось выделить память под объекты\n");
+        return EXIT_FAILURE;
+    }
+
+    const struct {
+        const char* name;
+        ArenaOptions options;
+    } variants[] = {
+        {"unmap", {ARENA_BACKEND_FREE_LIST, ARENA_DEFAULT_CHUNK_SIZE, 1, ARENA_HUGE_NONE, ARENA_RELEASE_UNMAP}},
+        {"decommit", {ARENA_BACKEND_FREE_LIST, ARENA_DEFAULT_CHUNK_SIZE, 1, ARENA_HUGE_NONE, ARENA_RELEASE_DECOMMIT}},
+        {"retain", {ARENA_BACKEND_FREE_LIST, ARENA_DEFAULT_CHUNK_SIZE, ARENA_MAX_CHUNKS, ARENA_HUGE_NONE,
+                    ARENA_RELEASE_UNMAP}},
+        {"thp", {ARENA_BACKEND_FREE_LIST, ARENA_DEFAULT_CHUNK_SIZE, 1, ARENA_HUGE_TRANSPARENT,
+                 ARENA_RELEASE_UNMAP}},
+    };
+
+    printf("%-10s %-8s %12s %12s %12s %12s\n", "policy", "phase", "live", "mapped", "committed", "rss");
+
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        size_t baseline = resident_bytes();
+        Arena* arena = arena_create(&variants[v].options);
+        if (!arena) {
+            free(objects);
+            return EXIT_FAILURE;
+        }
+
+        uint64_t rng = 88172645463325252ull;
+        size_t live = 0;
+        for (int round = 0; round < rounds; round++) {
+            for (size_t i = 0; i < count; i++) {
+                if (objects[i]) continue;
+                size_t size = uniform_size(&rng);
+                objects[i] = arena_alloc(arena, size);
+                if (!objects[i]) continue;
+                memset(objects[i], 0xab, size);
+                live += size;
+            }
+            print_arena_row(variants[v].name, "grown", live, arena, baseline);
+
+            live = 0;
+            for (size_t i = 0; i < count; i++) {
+                if (i < count / 32) {
+                    if (objects[i]) live += arena_usable_size(arena, objects[i]);
+                    continue;
+                }
+                arena_free(arena, objects[i]);
+                objects[i] = NULL;
+            }
+            print_arena_row(variants[v].name, "shrunk", live, arena, baseline);
+        }
+
+        arena_destroy(arena);
+        memset(objects, 0, count * sizeof(void*));
+    }
+
+    free(objects);
+    return EXIT_SUCCESS;
+}
+
+typedef struct VectorAllocator {
+    const char* name;
+    void* (*realloc)(void* state, void* memory, size_t size);
+    void (*free)(void* state, void* memory);
+    void* state;
+} VectorAllocator;
+
+static void* list_realloc(void* state, void* memory, size_t size) {
+    return allocator_realloc(state, memory, size);
+}
+
+static void* buddy_realloc(void* state, void* memory, size_t size) {
+    return buddy_allocator_realloc(state, memory, size);
+}
+
+static void* system_realloc(void* state, void* memory, size_t size) {
+    (void)state;
+    return realloc(memory, size);
+}
+
+// Grows `vectors` buffers round-robin by `step` bytes until each reaches
+// `max_size`, the way an append-only string or vector with exact sizing
+// does. Bytes a move had to copy are compared with the alloc/copy/free
+// baseline, which copies the old contents on every growth.
+static int bench_vector(size_t vectors, size_t max_size, size_t step) {
+    char** buffers = calloc(vectors, sizeof(char*));
+    size_t* sizes = calloc(vectors, sizeof(size_t));
+    if (!buffers || !sizes) {
+        fprintf(stderr, "Не удалось выделить память под векторы\n");
+        free(buffers);
+        free(sizes);
+        return EXIT_FAILURE;
+    }
+
+    printf("%-10s %10s %10s %14s %14s %8s %12s\n", "allocator", "reallocs", "in_place", "copied",
+           "naive_copied", "saved", "ops/s");
+
+    for (int variant = 0; variant < 3; variant++) {
+        VectorAllocator allocator;
+        char* arena = variant < 2 ? map_arena(SUITE_ARENA_SIZE) : NULL;
+
+        switch (variant) {
+            case 0:
+                allocator = (VectorAllocator){"free-list", list_realloc, list_free,
+                                              allocator_create(arena, SUITE_ARENA_SIZE)};
+                break;
+            case 1:
+                allocator = (VectorAllocator){"buddy", buddy_realloc, buddy_free,
+                                              buddy_allocator_create(arena, SUITE_ARENA_SIZE)};
+                break;
+            default:
+                allocator = (VectorAllocator){"malloc", system_realloc, system_free, NULL};
+                break;
+        }
+        if (arena && !allocator.state) {
+            fprintf(stderr, "%s: не удалось создать аллокатор\n", allocator.name);
+            munmap(arena, SUITE_ARENA_SIZE);
+            free(sizes);
+            free(buffers);
+            return EXIT_FAILURE;
+        }
+
+        size_t reallocs = 0;
+        size_t in_place = 0;
+        size_t copied = 0;
+        size_t naive = 0;
+        size_t failures = 0;
+        int corrupted = 0;
+        memset(sizes, 0, vectors * sizeof(size_t));
+
+        double start = now_seconds();
+        for (size_t size = step; size <= max_size; size += step) {
+            for (size_t v = 0; v < vectors; v++) {
+                if (sizes[v] != size - step) continue;
+
+                char* grown = allocator.realloc(allocator.state, buffers[v], size);
+                if (!grown) {
+                    failures++;
+                    continue;
+                }
+
+                reallocs++;
+                naive += sizes[v];
+                if (grown == buffers[v]) {
+                    in_place++;
+                } else {
+                    copied += sizes[v];
+                }
+
+                // Appended bytes carry the vector index, checked at the end.
+                memset(grown + sizes[v], (int)(v & 0xff), step);
+                buffers[v] = grown;
+                sizes[v] = size;
+            }
+        }
+        double elapsed = now_seconds() - start;
+
+        for (size_t v = 0; v < vectors; v++) {
+            for (size_t i = 0; i < sizes[v]; i++) {
+                if ((unsigned char)buffers[v][i] != (v & 0xff)) corrupted = 1;
+            }
+            allocator.free(allocator.state, buffers[v]);
+            buffers[v] = NULL;
+        }
+
+        printf("%-10s %10zu %10zu %14zu %14zu %7.1f%% %12.0f", allocator.name, reallocs, in_place, copied,
+               naive, naive ? 100.0 * (double)(naive - copied) / (double)naive : 0.0,
+               (double)reallocs / elapsed);
+        if (failures) printf("  (отказов: %zu)", failures);
+        if (corrupted) printf("  ДАННЫЕ ПОВРЕЖДЕНЫ");
+        printf("\n");
+        if (arena) munmap(arena, SUITE_ARENA_SIZE);
+    }
+
+    free(sizes);
+    free(buffers);
+    return EXIT_SUCCESS;
+}
+
+// Per-message scratch memory: a message gets its result block, which
+// lives until the end of the batch, and a few temporaries that die with
+// the message, the way a line transform builds its output. `rewind` makes
+// the region drop temporaries per message through a mark, otherwise it
+// only resets at the end of the batch. Heap allocators free every block.
+typedef struct ScratchResult {
+    double elapsed;
+    size_t allocs;
+    size_t peak_footprint;
+    size_t failures;
+} ScratchResult;
+
+// `results` has room for one block per message of a batch.
+static ScratchResult run_scratch(const BenchAllocator* allocator, Region* region, int rewind, size_t batches,
+                                 size_t messages, void** results) {
+    ScratchResult result = {0};
+    void* temporaries[SCRATCH_MAX_TEMPORARIES];
+    int system = !region && allocator->alloc == system_alloc;
+    size_t held = 0;
+    uint64_t rng = 88172645463325252ull;
+
+    double start = now_seconds();
+    for (size_t batch = 0; batch < batches; batch++) {
+        for (size_t m = 0; m < messages; m++) {
+            size_t size = 16 + (size_t)(xorshift(&rng) % 4081);
+            char* output = region ? region_alloc(region, size) : allocator->alloc(allocator->state, size);
+            if (output) {
+                output[0] = output[size - 1] = 1;
+                if (system) held += malloc_usable_size(output) + sizeof(size_t);
+            } else {
+                result.failures++;
+            }
+            results[m] = output;
+
+            RegionMark mark = {0};
+            if (region && rewind) mark = region_mark(region);
+
+            size_t count = 2 + (size_t)(xorshift(&rng) % (SCRATCH_MAX_TEMPORARIES - 1));
+            for (size_t t = 0; t < count; t++) {
+                size = 16 + (size_t)(xorshift(&rng) % 497);
+                char* memory = region ? region_alloc(region, size) : allocator->alloc(allocator->state, size);
+                if (memory) {
+                    memory[0] = memory[size - 1] = 1;
+                    if (system) held += malloc_usable_size(memory) + sizeof(size_t);
+                } else {
+                    result.failures++;
+                }
+                temporaries[t] = memory;
+            }
+            result.allocs += count + 1;
+            if (system && held > result.peak_footprint) result.peak_footprint = held;
+
+            if (region) {
+                if (rewind) region_rewind(region, mark);
+                continue;
+            }
+            for (size_t t = 0; t < count; t++) {
+                if (!temporaries[t]) continue;
+                if (system) held -= malloc_usable_size(temporaries[t]) + sizeof(size_t);
+                allocator->free(allocator->state, temporaries[t]);
+            }
+        }
+
+        if (region) {
+            region_reset(region);
+            continue;
+        }
+        for (size_t m = 0; m < messages; m++) {
+            if (!results[m]) continue;
+            if (system) held -= malloc_usable_size(results[m]) + sizeof(size_t);
+            allocator->free(allocator->state, results[m]);
+        }
+    }
+    result.elapsed = now_seconds() - start;
+    return result;
+}
+
+// Footprint is the pages touched for the arena allocators, chunks mapped
+// for the region (they are kept across batches, so this is the peak) and
+// the held chunk bytes for malloc.
+static int bench_scratch(size_t batches, size_t messages) {
+    void** results = calloc(messages, sizeof(void*));
+    if (!results) {
+        fprintf(stderr, "Не удалось выделить память под %zu сообщений\n", messages);
+        return EXIT_FAILURE;
+    }
+
+    printf("%-14s %10s %12s %10s %12s %9s\n", "allocator", "allocs", "allocs/s", "ns/alloc", "peak_fp",
+           "failures");
+
+    for (int variant = 0; variant < 5; variant++) {
+        BenchAllocator allocator = {"malloc", system_alloc, system_free, NULL, NULL};
+        char* arena = variant < 2 ? map_arena(SUITE_ARENA_SIZE) : NULL;
+        Region* region = NULL;
+
+        switch (variant) {
+            case 0:
+                allocator = (BenchAllocator){"free-list", list_alloc, list_free,
+                                             allocator_create(arena, SUITE_ARENA_SIZE), list_free_bytes};
+                break;
+            case 1:
+                allocator = (BenchAllocator){"buddy", buddy_alloc, buddy_free,
+                                             buddy_allocator_create(arena, SUITE_ARENA_SIZE), buddy_free_bytes};
+                break;
+            case 3:
+            case 4:
+                region = region_create(0);
+                if (!region) {
+                    fprintf(stderr, "Не удалось создать регион\n");
+                    free(results);
+                    return EXIT_FAILURE;
+                }
+                allocator.name = variant == 3 ? "region/rewind" : "region/reset";
+                break;
+            default:
+                break;
+        }
+
+        if (arena && !allocator.state) {
+            fprintf(stderr, "%s: не удалось создать аллокатор\n", allocator.name);
+            munmap(arena, SUITE_ARENA_SIZE);
+            free(results);
+            return EXIT_FAILURE;
+        }
+
+        ScratchResult result = run_scratch(&allocator, region, variant == 3, batches, messages, results);
+        if (arena) {
+            result.peak_footprint = touched_bytes(arena, SUITE_ARENA_SIZE);
+            munmap(arena, SUITE_ARENA_SIZE);
+        }
+        if (region) {
+            result.peak_footprint = region_mapped_bytes(region);
+            region_destroy(region);
+        }
+
+        printf("%-14s %10zu %12.0f %10.1f %12zu %9zu\n", allocator.name, result.allocs,
+               (double)result.allocs / result.elapsed, result.elapsed * 1e9 / (double)result.allocs,
+               result.peak_footprint, result.failures);
+    }
+
+    free(results);
+    return EXIT_SUCCESS;
+}
+
+static uint32_t message_checksum(const unsigned char* data, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+}
+
+// Maps the segment a second time, so the consumer sees it at another
+// address than the producer and only offsets can be exchanged.
+static int shm_consumer(int fd) {
+    char* memory = mmap(NULL, SHM_SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) return 2;
+
+    ShmAllocator* allocator = shm_allocator_attach(memory, SHM_SEGMENT_SIZE);
+    if (!allocator) return 2;
+    ShmQueue* queue = shm_allocator_ptr(allocator, shm_allocator_root(allocator));
+    unsigned char* local = malloc(SHM_FIXED_SLOT);
+    if (!local) return 2;
+
+    int errors = 0;
+    for (;;) {
+        sem_wait(&queue->items);
+        uint32_t slot = queue->head++ % SHM_QUEUE_SLOTS;
+
+        if (queue->fixed) {
+            ShmMessage* message = (ShmMessage*)((char*)shm_allocator_ptr(allocator, queue->slots) +
+                                                (size_t)slot * SHM_FIXED_SLOT);
+            uint32_t length = message->length;
+            uint32_t checksum = message->checksum;
+            if (length) memcpy(local, message->data, length);
+            sem_post(&queue->free_slots);
+            if (!length) break;
+            if (message_checksum(local, length) != checksum) errors++;
+        } else {
+            ShmOffset offset = queue->messages[slot];
+            sem_post(&queue->free_slots);
+            if (!offset) break;
+
+            ShmMessage* message = shm_allocator_ptr(allocator, offset);
+            if (message_checksum(message->data, message->length) != message->checksum) errors++;
+            if (shm_allocator_free(allocator, offset) != 0) {
+                errors++;
+                break;
+            }
+        }
+    }
+
+    free(local);
+    munmap(memory, SHM_SEGMENT_SIZE);
+    return errors ? 1 : 0;
+}
+
+static int run_shm(int fixed, size_t messages, double* elapsed, size_t* peak_shared, size_t* payload) {
+    shm_unlink(SHM_SEGMENT_NAME);
+    int fd = shm_open(SHM_SEGMENT_NAME, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1) return -1;
+    shm_unlink(SHM_SEGMENT_NAME);
+
+    char* memory = MAP_FAILED;
+    if (ftruncate(fd, (off_t)SHM_SEGMENT_SIZE) == 0) {
+        memory = mmap(NULL, SHM_SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ShmAllocator* allocator = memory == MAP_FAILED ? NULL : shm_allocator_create(memory, SHM_SEGMENT_SIZE);
+    ShmOffset queue_offset = allocator ? shm_allocator_alloc(allocator, sizeof(ShmQueue)) : SHM_NULL;
+    if (!queue_offset) {
+        close(fd);
+        return -1;
+    }
+
+    ShmQueue* queue = shm_allocator_ptr(allocator, queue_offset);
+    memset(queue, 0, sizeof(*queue));
+    sem_init(&queue->items, 1, 0);
+    sem_init(&queue->free_slots, 1, SHM_QUEUE_SLOTS);
+    queue->fixed = fixed;
+    if (fixed) queue->slots = shm_allocator_alloc(allocator, (size_t)SHM_QUEUE_SLOTS * SHM_FIXED_SLOT);
+    shm_allocator_set_root(allocator, queue_offset);
+    size_t baseline = shm_allocator_free_bytes(allocator);
+
+    // Allocated before the fork, so a failure leaves no consumer behind.
+    unsigned char* local = malloc(SHM_FIXED_SLOT);
+    pid_t pid = local ? fork() : -1;
+    if (pid == 0) _exit(shm_consumer(fd));
+    if (pid == -1) {
+        free(local);
+        close(fd);
+        return -1;
+    }
+
+    uint64_t rng = 88172645463325252ull;
+    size_t peak = fixed ? (size_t)SHM_QUEUE_SLOTS * SHM_FIXED_SLOT : 0;
+    *payload = 0;
+
+    double start = now_seconds();
+    for (size_t i = 0; i <= messages; i++) {
+        uint32_t length = i < messages ? (uint32_t)(uniform_size(&rng) - sizeof(ShmMessage)) : 0;
+        for (uint32_t j = 0; j < length; j++) local[j] = (unsigned char)(i + j * 31);
+        uint32_t checksum = message_checksum(local, length);
+        *payload += length;
+
+        sem_wait(&queue->free_slots);
+        uint32_t slot = queue->tail++ % SHM_QUEUE_SLOTS;
+
+        if (fixed) {
+            ShmMessage* message = (ShmMessage*)((char*)shm_allocator_ptr(allocator, queue->slots) +
+                                                (size_t)slot * SHM_FIXED_SLOT);
+            message->length = length;
+            message->checksum = checksum;
+            memcpy(message->data, local, length);
+        } else if (length) {
+            // A real producer would build the message in place; the copy
+            // stands in for that so both modes touch the payload once.
+            ShmOffset offset;
+            while (!(offset = shm_allocator_alloc(allocator, sizeof(ShmMessage) + length))) {
+                if (errno == ENOTRECOVERABLE) break;
+                sched_yield();
+            }
+            if (!offset) {
+                kill(pid, SIGKILL);
+                break;
+            }
+            ShmMessage* message = shm_allocator_ptr(allocator, offset);
+            message->length = length;
+            message->checksum = checksum;
+            memcpy(message->data, local, length);
+            queue->messages[slot] = offset;
+
+            if (i % LATENCY_SAMPLE_EVERY == 0) {
+                size_t used = baseline - shm_allocator_free_bytes(allocator);
+                if (used > peak) peak = used;
+            }
+        } else {
+            queue->messages[slot] = SHM_NULL;
+        }
+        sem_post(&queue->items);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    *elapsed = now_seconds() - start;
+    *peak_shared = peak;
+
+    free(local);
+    sem_destroy(&queue->items);
+    sem_destroy(&queue->free_slots);
+    shm_allocator_destroy(allocator);
+    munmap(memory, SHM_SEGMENT_SIZE);
+    close(fd);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// Producer to forked consumer through one shared segment: exactly sized
+// messages handed over as offsets versus copies through fixed slots.
+static int bench_shm(size_t messages) {
+    printf("%-8s %10s %12s %10s %14s %8s\n", "mode", "messages", "msgs/s", "MB/s", "shared_bytes", "errors");
+
+    for (int fixed = 0; fixed < 2; fixed++) {
+        double elapsed = 0.0;
+        size_t peak = 0;
+        size_t payload = 0;
+        int result = run_shm(fixed, messages, &elapsed, &peak, &payload);
+        if (result < 0) {
+            perror("shm");
+            return EXIT_FAILURE;
+        }
+
+        printf("%-8s %10zu %12.0f %10.1f %14zu %8s\n", fixed ? "fixed" : "offsets", messages,
+               (double)messages / elapsed, (double)payload / elapsed / 1e6, peak, result ? "yes" : "no");
+    }
+    return EXIT_SUCCESS;
+}
+
+static void usage(const char* name) {
+    fprintf(stderr,
+            "Usage: %s threads [max_threads] [ops_per_thread]\n"
+            "       %s slab [objects] [ops]\n"
+            "       %s workload [uniform|powerlaw|prodcons|lifo|fifo|all] [ops]\n"
+            "       %s replay <trace>\n"
+            "       %s plugin <library.so> [workload|all] [ops]\n"
+            "       %s arena [objects] [rounds]\n"
+            "       %s vector [vectors] [max_size] [step]\n"
+            "       %s scratch [batches] [messages_per_batch]\n"
+            "       %s shm [messages]\n",
+            name, name, name, name, name, name, name, name, name);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (strcmp(argv[1], "threads") == 0) {
+        int max_threads = argc > 2 ? atoi(argv[2]) : 8;
+        size_t ops = argc > 3 ? (size_t)atol(argv[3]) : 1000000;
+        if (max_threads < 1 || ops == 0) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        return bench_threads(max_threads, ops);
+    }
+
+    if (strcmp(argv[1], "slab") == 0) {
+        size_t count = argc > 2 ? (size_t)atol(argv[2]) : 5000;
+        size_t ops = argc > 3 ? (size_t)atol(argv[3]) : 5000000;
+        if (count == 0) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        return bench_slab(count, ops);
+    }
+
+    if (strcmp(argv[1], "workload") == 0) {
+        const char* name = argc > 2 ? argv[2] : "all";
+        size_t ops = argc > 3 ? (size_t)atol(argv[3]) : 1000000;
+        if (ops == 0 || bench_workload(name, ops) != EXIT_SUCCESS) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    if (strcmp(argv[1], "replay") == 0 && argc > 2) {
+        return bench_replay(argv[2]);
+    }
+
+    if (strcmp(argv[1], "plugin") == 0 && argc > 2) {
+        const char* name = argc > 3 ? argv[3] : "all";
+        size_t ops = argc > 4 ? (size_t)atol(argv[4]) : 1000000;
+        return bench_plugin(argv[2], name, ops);
+    }
+
+    if (strcmp(argv[1], "arena") == 0) {
+        size_t count = argc > 2 ? (size_t)atol(argv[2]) : 100000;
+        int rounds = argc > 3 ? atoi(argv[3]) : 2;
+        if (count == 0 || rounds < 1) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        return bench_arena(count, rounds);
+    }
+
+    if (strcmp(argv[1], "vector") == 0) {
+        size_t vectors = argc > 2 ? (size_t)atol(argv[2]) : 16;
+        size_t max_size = argc > 3 ? (size_t)atol(argv[3]) : 16384;
+        size_t step = argc > 4 ? (size_t)atol(argv[4]) : 64;
+        if (vectors == 0 || step == 0 || max_size < step) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        return bench_vector(vectors, max_size, step);
+    }
+
+    if (strcmp(argv[1], "scratch") == 0) {
+        size_t batches = argc > 2 ? (size_t)atol(argv[2]) : 20000;
+        size_t messages = argc > 3 ? (size_t)atol(argv[3]) : 64;
+        if (batches == 0 || messages == 0) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        return bench_scratch(batches, messages);
+    }
+
+    if (strcmp(argv[1], "shm") == 0) {
+        size_t messages = argc > 2 ? (size_t)atol(argv[2]) : 200000;
+        if (messages == 0) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        return bench_shm(messages);
+    }
+
+    usage(argv[0]);
+    return EXIT_FAILURE;
+}
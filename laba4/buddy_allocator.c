@@ -1,59 +1,385 @@
 #include "buddy_allocator.h"
-#include <math.h>
+#include <string.h>
+
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static size_t floor_log2(size_t value) {
+    return 63 - (size_t)__builtin_clzll(value);
+}
+
+// Smallest order whose block holds `size` bytes plus the header.
+static size_t order_for(const BuddyAllocator* allocator, size_t size) {
+    size_t need = size + sizeof(BuddyHeader);
+    if (need <= ((size_t)1 << allocator->min_order)) return allocator->min_order;
+    return 64 - (size_t)__builtin_clzll(need - 1);
+}
+
+// Offset of the buddy of the block at `offset`, or SIZE_MAX for the
+// top-level blocks whose buddy would lie past the end of the arena.
+static size_t buddy_of(const BuddyAllocator* allocator, size_t order, size_t offset) {
+    size_t buddy = offset ^ ((size_t)1 << order);
+    if (buddy > allocator->memory_size - ((size_t)1 << order)) return SIZE_MAX;
+    return buddy;
+}
+
+static size_t bit_index(const BuddyAllocator* allocator, size_t order, size_t offset) {
+    return allocator->bitmap_offsets[order] + (offset >> order);
+}
+
+static int is_free(const BuddyAllocator* allocator, size_t order, size_t offset) {
+    size_t bit = bit_index(allocator, order, offset);
+    return (allocator->free_bitmap[bit / 8] >> (bit % 8)) & 1;
+}
+
+static void set_free(BuddyAllocator* allocator, size_t order, size_t offset, int value) {
+    size_t bit = bit_index(allocator, order, offset);
+    if (value) {
+        allocator->free_bitmap[bit / 8] |= (uint8_t)(1u << (bit % 8));
+    } else {
+        allocator->free_bitmap[bit / 8] &= (uint8_t)~(1u << (bit % 8));
+    }
+}
+
+static void push_block(BuddyAllocator* allocator, size_t order, size_t offset) {
+    BuddyNode* node = (BuddyNode*)((char*)allocator->memory_start + offset);
+    node->prev = NULL;
+    node->next = allocator->free_lists[order];
+    if (node->next) node->next->prev = node;
+    allocator->free_lists[order] = node;
+    allocator->nonempty_orders |= 1ull << order;
+    allocator->free_bytes += (size_t)1 << order;
+    set_free(allocator, order, offset, 1);
+}
+
+static void remove_block(BuddyAllocator* allocator, size_t order, size_t offset) {
+    BuddyNode* node = (BuddyNode*)((char*)allocator->memory_start + offset);
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        allocator->free_lists[order] = node->next;
+    }
+    if (node->next) node->next->prev = node->prev;
+
+    if (!allocator->free_lists[order]) allocator->nonempty_orders &= ~(1ull << order);
+    allocator->free_bytes -= (size_t)1 << order;
+    set_free(allocator, order, offset, 0);
+}
+
+static void note_growth(BuddyAllocator* allocator) {
+    size_t live = allocator->memory_size - allocator->free_bytes;
+    if (live > allocator->peak_bytes) allocator->peak_bytes = live;
+}
+
+static BuddyHeader* header_of(const void* memory) {
+    return (BuddyHeader*)((char*)memory - sizeof(BuddyHeader));
+}
+
+static size_t offset_of(const BuddyAllocator* allocator, const BuddyHeader* header) {
+    return (size_t)((const char*)header - header->reserved - (const char*)allocator->memory_start);
+}
+
+static size_t default_min_order(size_t size) {
+    return size >= LARGE_ARENA_SIZE ? LARGE_ARENA_MIN_BUDDY_ORDER : MIN_BUDDY_ORDER;
+}
+
+// Bitmap bytes for an arena whose space past the struct is `limit`: one
+// bit per possible block of every order. Fills `offsets` if given.
+static size_t bitmap_size(size_t limit, size_t min_order, size_t* offsets) {
+    size_t bits = 0;
+    for (size_t order = min_order; order <= floor_log2(limit); order++) {
+        if (offsets) offsets[order] = bits;
+        bits += limit >> order;
+    }
+    return (bits + 7) / 8;
+}
 
 BuddyAllocator* buddy_allocator_create(void* memory, size_t size) {
-    if (size < (1 << MAX_BUDDY_ORDER)) return NULL;
+    return buddy_allocator_create_with_min_order(memory, size, default_min_order(size));
+}
 
-    BuddyAllocator* allocator = (BuddyAllocator*)memory;
-    allocator->memory_start = (char*)memory + sizeof(BuddyAllocator);
-    allocator->memory_size = size - sizeof(BuddyAllocator);
+// The bitmap grows with the arena, so iterate to the fixed point; the
+// extra BUDDY_BASE_ALIGNMENT covers aligning the base wherever the arena
+// starts.
+size_t buddy_allocator_required_size(size_t usable) {
+    if (usable == 0 || usable > SIZE_MAX / 4) return 0;
 
-    for (int i = 0; i <= MAX_BUDDY_ORDER; i++) {
-        allocator->free_lists[i] = NULL;
+    size_t size = sizeof(BuddyAllocator) + BUDDY_BASE_ALIGNMENT + usable;
+    for (;;) {
+        size_t bitmap_bytes = bitmap_size(size - sizeof(BuddyAllocator), default_min_order(size), NULL);
+        size_t needed = sizeof(BuddyAllocator) + bitmap_bytes + BUDDY_BASE_ALIGNMENT + usable;
+        if (needed <= size) return size;
+        size = needed;
     }
+}
+
+BuddyAllocator* buddy_allocator_create_with_min_order(void* memory, size_t size, size_t min_order) {
+    if (!memory || size < sizeof(BuddyAllocator) + BUDDY_BASE_ALIGNMENT) return NULL;
+    if (min_order < MIN_BUDDY_ORDER || min_order >= BUDDY_ORDER_COUNT - 1) return NULL;
 
-    size_t initial_order = (size_t)log2(size);
-    allocator->free_lists[initial_order] = (FreeBlock*)allocator->memory_start;
-    allocator->free_lists[initial_order]->size = size;
-    allocator->free_lists[initial_order]->next = NULL;
+    // Size the bitmap for everything past the struct; the arena left after
+    // the bitmap is smaller, so it is always covered.
+    size_t start = (size_t)memory;
+    size_t end = start + size;
+    size_t limit = size - sizeof(BuddyAllocator);
+    if (limit < ((size_t)1 << min_order)) return NULL;
 
+    size_t bitmap_offsets[BUDDY_ORDER_COUNT] = {0};
+    size_t bitmap_bytes = bitmap_size(limit, min_order, bitmap_offsets);
+
+    size_t base = align_up(start + sizeof(BuddyAllocator) + bitmap_bytes, BUDDY_BASE_ALIGNMENT);
+    if (base >= end) return NULL;
+    size_t usable = (end - base) & ~(((size_t)1 << min_order) - 1);
+    if (usable == 0) return NULL;
+
+    BuddyAllocator* allocator = (BuddyAllocator*)memory;
+    allocator->memory_start = (void*)base;
+    allocator->memory_size = usable;
+    allocator->min_order = min_order;
+    allocator->max_order = floor_log2(usable);
+    allocator->free_bytes = 0;
+    allocator->nonempty_orders = 0;
+    allocator->free_bitmap = (uint8_t*)memory + sizeof(BuddyAllocator);
+    memset(allocator->free_bitmap, 0, bitmap_bytes);
+
+    allocator->peak_bytes = 0;
+    allocator->alloc_count = 0;
+    allocator->free_count = 0;
+    allocator->realloc_count = 0;
+    for (size_t order = 0; order < BUDDY_ORDER_COUNT; order++) {
+        allocator->bitmap_offsets[order] = bitmap_offsets[order];
+        allocator->free_lists[order] = NULL;
+        allocator->order_allocs[order] = 0;
+    }
+
+    // One top-level block per set bit of the arena size, largest first, so
+    // every block stays aligned to its own size.
+    size_t offset = 0;
+    for (size_t order = allocator->max_order + 1; order-- > min_order;) {
+        if (usable & ((size_t)1 << order)) {
+            push_block(allocator, order, offset);
+            offset += (size_t)1 << order;
+        }
+    }
     return allocator;
 }
 
+void buddy_allocator_destroy(BuddyAllocator* allocator) {
+    (void)allocator;
+}
+
 void* buddy_allocator_alloc(BuddyAllocator* allocator, size_t size) {
-    if (size == 0) return NULL;
-
-    size_t order = (size_t)ceil(log2(size + sizeof(FreeBlock)));
-
-    for (size_t i = order; i <= MAX_BUDDY_ORDER; i++) {
-        if (allocator->free_lists[i]) {
-            FreeBlock* block = allocator->free_lists[i];
-            allocator->free_lists[i] = block->next;
-
-            while (i > order) {
-                i--;
-                size_t block_size = 1 << i;
-                FreeBlock* buddy = (FreeBlock*)((char*)block + block_size);
-                buddy->size = block_size;
-                buddy->next = allocator->free_lists[i];
-                allocator->free_lists[i] = buddy;
-            }
-
-            block->size = (1 << order);
-            return (char*)block + sizeof(FreeBlock);
-        }
+    if (size == 0 || size > allocator->memory_size) return NULL;
+
+    size_t order = order_for(allocator, size);
+    if (order > allocator->max_order) return NULL;
+
+    uint64_t candidates = allocator->nonempty_orders & (~0ull << order);
+    if (!candidates) return NULL;
+
+    size_t current = (size_t)__builtin_ctzll(candidates);
+    BuddyNode* node = allocator->free_lists[current];
+    size_t offset = (size_t)((char*)node - (char*)allocator->memory_start);
+    remove_block(allocator, current, offset);
+
+    while (current > order) {
+        current--;
+        push_block(allocator, current, offset + ((size_t)1 << current));
     }
 
-    return NULL;
+    BuddyHeader* header = (BuddyHeader*)node;
+    header->order = order;
+    header->reserved = 0;
+
+    allocator->alloc_count++;
+    allocator->order_allocs[order]++;
+    note_growth(allocator);
+    return (char*)header + sizeof(BuddyHeader);
+}
+
+void* buddy_allocator_aligned_alloc(BuddyAllocator* allocator, size_t alignment, size_t size) {
+    if (alignment == 0 || (alignment & (alignment - 1))) return NULL;
+    if (alignment <= sizeof(BuddyHeader)) return buddy_allocator_alloc(allocator, size);
+    if (size == 0 || size + alignment < size) return NULL;
+
+    char* memory = buddy_allocator_alloc(allocator, size + alignment);
+    if (!memory || ((size_t)memory & (alignment - 1)) == 0) return memory;
+
+    // A second header right before the aligned payload records how far
+    // back the block starts.
+    char* start = memory - sizeof(BuddyHeader);
+    char* aligned = (char*)align_up((size_t)memory, alignment);
+    BuddyHeader* header = (BuddyHeader*)(aligned - sizeof(BuddyHeader));
+    header->order = ((BuddyHeader*)start)->order;
+    header->reserved = (size_t)((char*)header - start);
+    return aligned;
 }
 
 void buddy_allocator_free(BuddyAllocator* allocator, void* memory) {
     if (!memory) return;
 
-    FreeBlock* block = (FreeBlock*)((char*)memory - sizeof(FreeBlock));
-    size_t order = (size_t)log2(block->size);
+    BuddyHeader* header = header_of(memory);
+    size_t order = header->order;
+    size_t offset = offset_of(allocator, header);
+    allocator->free_count++;
+
+    while (order < allocator->max_order) {
+        size_t buddy = buddy_of(allocator, order, offset);
+        if (buddy == SIZE_MAX || !is_free(allocator, order, buddy)) break;
+
+        remove_block(allocator, order, buddy);
+        offset &= ~((size_t)1 << order);
+        order++;
+    }
+
+    push_block(allocator, order, offset);
+}
+
+void* buddy_allocator_realloc(BuddyAllocator* allocator, void* memory, size_t size) {
+    if (!memory) return buddy_allocator_alloc(allocator, size);
+    if (size == 0) {
+        buddy_allocator_free(allocator, memory);
+        return NULL;
+    }
+    if (size > allocator->memory_size) return NULL;
+
+    BuddyHeader* header = header_of(memory);
+    size_t order = header->order;
+    size_t offset = offset_of(allocator, header);
+    size_t target = order_for(allocator, size + header->reserved);
+    allocator->realloc_count++;
+
+    // Shrinking hands the upper halves back, their buddies are the lower
+    // halves still in use, so nothing can merge.
+    if (target <= order) {
+        while (order > target) {
+            order--;
+            push_block(allocator, order, offset + ((size_t)1 << order));
+        }
+        header->order = order;
+        return memory;
+    }
+
+    // Growing in place needs the block to be the lower half at every level
+    // up to the target order, with each upper buddy free.
+    size_t level = order;
+    if (target <= allocator->max_order) {
+        while (level < target && !(offset & ((size_t)1 << level))) {
+            size_t buddy = buddy_of(allocator, level, offset);
+            if (buddy == SIZE_MAX || !is_free(allocator, level, buddy)) break;
+            level++;
+        }
+    }
+    if (level == target) {
+        for (size_t i = order; i < target; i++) {
+            remove_block(allocator, i, offset + ((size_t)1 << i));
+        }
+        header->order = target;
+        note_growth(allocator);
+        return memory;
+    }
+
+    void* moved = buddy_allocator_alloc(allocator, size);
+    if (!moved) return NULL;
+
+    memcpy(moved, memory, buddy_allocator_usable_size(allocator, memory));
+    buddy_allocator_free(allocator, memory);
+    return moved;
+}
+
+size_t buddy_allocator_usable_size(const BuddyAllocator* allocator, const void* memory) {
+    (void)allocator;
+    const BuddyHeader* header = header_of(memory);
+    return ((size_t)1 << header->order) - sizeof(BuddyHeader) - header->reserved;
+}
+
+size_t buddy_allocator_free_bytes(const BuddyAllocator* allocator) {
+    return allocator->free_bytes;
+}
+
+size_t buddy_allocator_largest_free_block(const BuddyAllocator* allocator) {
+    if (!allocator->nonempty_orders) return 0;
+
+    size_t order = 63 - (size_t)__builtin_clzll(allocator->nonempty_orders);
+    return ((size_t)1 << order) - sizeof(BuddyHeader);
+}
+
+double buddy_allocator_fragmentation(const BuddyAllocator* allocator) {
+    if (allocator->free_bytes == 0) return 0.0;
+
+    // Free bytes fully merged form at best one power-of-two block, and no
+    // block outgrows the largest top-level one.
+    size_t order = floor_log2(allocator->free_bytes);
+    if (order > allocator->max_order) order = allocator->max_order;
+
+    size_t largest = buddy_allocator_largest_free_block(allocator) + sizeof(BuddyHeader);
+    return 1.0 - (double)largest / (double)((size_t)1 << order);
+}
+
+void buddy_allocator_stats(const BuddyAllocator* allocator, BuddyStats* stats) {
+    stats->capacity = allocator->memory_size;
+    stats->live_bytes = allocator->memory_size - allocator->free_bytes;
+    stats->peak_bytes = allocator->peak_bytes;
+    stats->free_bytes = allocator->free_bytes;
+    stats->largest_free_block = buddy_allocator_largest_free_block(allocator);
+    stats->fragmentation = buddy_allocator_fragmentation(allocator);
+    stats->alloc_count = allocator->alloc_count;
+    stats->free_count = allocator->free_count;
+    stats->realloc_count = allocator->realloc_count;
+
+    for (size_t order = 0; order < BUDDY_ORDER_COUNT; order++) {
+        stats->order_allocs[order] = allocator->order_allocs[order];
+        size_t length = 0;
+        for (const BuddyNode* node = allocator->free_lists[order]; node; node = node->next) length++;
+        stats->free_list_lengths[order] = length;
+    }
+}
+
+// Set bits among `count` bitmap bits starting at `first`.
+static size_t count_bits(const BuddyAllocator* allocator, size_t first, size_t count) {
+    size_t total = 0;
+    size_t bit = first;
+    size_t last = first + count;
+
+    for (; bit < last && bit % 8; bit++) total += (allocator->free_bitmap[bit / 8] >> (bit % 8)) & 1;
+    for (; bit + 8 <= last; bit += 8) total += (size_t)__builtin_popcount(allocator->free_bitmap[bit / 8]);
+    for (; bit < last; bit++) total += (allocator->free_bitmap[bit / 8] >> (bit % 8)) & 1;
+    return total;
+}
+
+int buddy_allocator_validate(const BuddyAllocator* allocator) {
+    const char* start = allocator->memory_start;
+    size_t free_bytes = 0;
+
+    for (size_t order = 0; order < BUDDY_ORDER_COUNT; order++) {
+        const BuddyNode* list = allocator->free_lists[order];
+        if (((allocator->nonempty_orders >> order) & 1) != (list != NULL)) return -1;
+        if (list && (order < allocator->min_order || order > allocator->max_order)) return -1;
+
+        // Listed blocks are aligned to their order, marked in the bitmap and
+        // have no free buddy they should have merged with.
+        size_t listed = 0;
+        const BuddyNode* prev = NULL;
+        for (const BuddyNode* node = list; node; node = node->next) {
+            size_t offset = (size_t)((const char*)node - start);
+            if ((const char*)node < start || offset >= allocator->memory_size) return -1;
+            if (offset & (((size_t)1 << order) - 1) || node->prev != prev) return -1;
+            if (!is_free(allocator, order, offset)) return -1;
+
+            size_t buddy = buddy_of(allocator, order, offset);
+            if (buddy != SIZE_MAX && is_free(allocator, order, buddy)) return -1;
+            if (++listed > allocator->memory_size >> order) return -1;
+            free_bytes += (size_t)1 << order;
+            prev = node;
+        }
+
+        // No bit is set for a block missing from the list.
+        if (order >= allocator->min_order && order <= allocator->max_order) {
+            size_t blocks = allocator->memory_size >> order;
+            if (count_bits(allocator, allocator->bitmap_offsets[order], blocks) != listed) return -1;
+        }
+    }
 
-    FreeBlock** current_list = &allocator->free_lists[order];
-    block->next = *current_list;
-    *current_list = block;
+    return free_bytes == allocator->free_bytes ? 0 : -1;
 }
@@ -1,20 +1,98 @@
 #ifndef BUDDY_ALLOCATOR_H
 #define BUDDY_ALLOCATOR_H
 
-#include "allocator.h"
 #include <stddef.h>
+#include <stdint.h>
 
-#define MAX_BUDDY_ORDER 20
+// Orders are picked per arena: the minimum is MIN_BUDDY_ORDER unless the
+// caller asks for a larger one, the maximum follows from the arena size.
+// BUDDY_ORDER_COUNT only bounds the per-order arrays.
+#define MIN_BUDDY_ORDER 5
+#define LARGE_ARENA_MIN_BUDDY_ORDER 6
+#define LARGE_ARENA_SIZE ((size_t)1 << 30)
+#define BUDDY_ORDER_COUNT 64
+#define BUDDY_BASE_ALIGNMENT 64
 
+// Every allocated block starts with a header recording its order, free
+// blocks are linked through their first bytes instead. An aligned payload
+// gets a second header right in front of it, `reserved` is its distance
+// from the start of the block (0 for ordinary blocks).
+typedef struct BuddyHeader {
+    size_t order;
+    size_t reserved;
+} BuddyHeader;
+
+typedef struct BuddyNode {
+    struct BuddyNode* next;
+    struct BuddyNode* prev;
+} BuddyNode;
+
+// Blocks are addressed by their offset from `memory_start`, so the buddy
+// of a block of order k is at offset ^ (1 << k). `free_bitmap` holds one
+// bit per possible block of every order, set while that block is free.
+// An arena that is not a power of two is carved into descending top-level
+// blocks (its binary representation); a buddy reaching past `memory_size`
+// does not exist, which stops merging at those blocks.
 typedef struct BuddyAllocator {
     void* memory_start;
     size_t memory_size;
-    FreeBlock* free_lists[MAX_BUDDY_ORDER + 1];
+    size_t min_order;
+    size_t max_order;
+    size_t free_bytes;
+    uint64_t nonempty_orders;
+    uint8_t* free_bitmap;
+    size_t bitmap_offsets[BUDDY_ORDER_COUNT];
+    BuddyNode* free_lists[BUDDY_ORDER_COUNT];
+    size_t peak_bytes;
+    size_t alloc_count;
+    size_t free_count;
+    size_t realloc_count;
+    size_t order_allocs[BUDDY_ORDER_COUNT];
 } BuddyAllocator;
 
+// Snapshot filled by buddy_allocator_stats; `order_allocs` counts blocks
+// handed out per order since creation.
+typedef struct BuddyStats {
+    size_t capacity;
+    size_t live_bytes;
+    size_t peak_bytes;
+    size_t free_bytes;
+    size_t largest_free_block;
+    double fragmentation;
+    size_t alloc_count;
+    size_t free_count;
+    size_t realloc_count;
+    size_t order_allocs[BUDDY_ORDER_COUNT];
+    size_t free_list_lengths[BUDDY_ORDER_COUNT];
+} BuddyStats;
+
+// Uses MIN_BUDDY_ORDER, or LARGE_ARENA_MIN_BUDDY_ORDER from LARGE_ARENA_SIZE
+// on, which halves the bitmap where 32-byte blocks matter less.
 BuddyAllocator* buddy_allocator_create(void* memory, size_t size);
+BuddyAllocator* buddy_allocator_create_with_min_order(void* memory, size_t size, size_t min_order);
+// Smallest arena for which buddy_allocator_create leaves at least `usable`
+// bytes of blocks, bitmap and alignment included; 0 if it would overflow.
+size_t buddy_allocator_required_size(size_t usable);
 void buddy_allocator_destroy(BuddyAllocator* allocator);
 void* buddy_allocator_alloc(BuddyAllocator* allocator, size_t size);
 void buddy_allocator_free(BuddyAllocator* allocator, void* memory);
+// Shrinks by splitting and grows by absorbing free upper buddies before
+// falling back to alloc, copy and free.
+void* buddy_allocator_realloc(BuddyAllocator* allocator, void* memory, size_t size);
+// `alignment` must be a power of two.
+void* buddy_allocator_aligned_alloc(BuddyAllocator* allocator, size_t alignment, size_t size);
+size_t buddy_allocator_usable_size(const BuddyAllocator* allocator, const void* memory);
+
+// Fragmentation compares the largest free block with the largest one the
+// free bytes could form given the carving, so an empty arena reports 0.
+size_t buddy_allocator_free_bytes(const BuddyAllocator* allocator);
+size_t buddy_allocator_largest_free_block(const BuddyAllocator* allocator);
+double buddy_allocator_fragmentation(const BuddyAllocator* allocator);
+
+void buddy_allocator_stats(const BuddyAllocator* allocator, BuddyStats* stats);
+
+// Cross-checks free lists, the free bitmap and the counters, and that no
+// two free buddies were left unmerged. Returns 0 if consistent, -1 otherwise.
+int buddy_allocator_validate(const BuddyAllocator* allocator);
 
 #endif // BUDDY_ALLOCATOR_H
@@ -0,0 +1,57 @@
+#include "allocator_api.h"
+#include "buddy_allocator.h"
+
+static void* plugin_create(void* memory, size_t size) {
+    return buddy_allocator_create(memory, size);
+}
+
+static void plugin_destroy(void* allocator) {
+    buddy_allocator_destroy(allocator);
+}
+
+static void* plugin_alloc(void* allocator, size_t size) {
+    return buddy_allocator_alloc(allocator, size);
+}
+
+static void plugin_free(void* allocator, void* memory) {
+    buddy_allocator_free(allocator, memory);
+}
+
+static void* plugin_realloc(void* allocator, void* memory, size_t size) {
+    return buddy_allocator_realloc(allocator, memory, size);
+}
+
+static void* plugin_aligned_alloc(void* allocator, size_t alignment, size_t size) {
+    return buddy_allocator_aligned_alloc(allocator, alignment, size);
+}
+
+static void plugin_stats(void* allocator, AllocatorApiStats* stats) {
+    BuddyStats snapshot;
+    buddy_allocator_stats(allocator, &snapshot);
+    stats->capacity = snapshot.capacity;
+    stats->free_bytes = snapshot.free_bytes;
+    stats->largest_free_block = snapshot.largest_free_block;
+    stats->live_bytes = snapshot.live_bytes;
+    stats->peak_bytes = snapshot.peak_bytes;
+    stats->alloc_count = snapshot.alloc_count;
+    stats->free_count = snapshot.free_count;
+    stats->fragmentation = snapshot.fragmentation;
+}
+
+static int plugin_validate(void* allocator) {
+    return buddy_allocator_validate(allocator);
+}
+
+const AllocatorApi allocator_api = {
+    ALLOCATOR_API_VERSION,
+    sizeof(AllocatorApi),
+    "buddy",
+    plugin_create,
+    plugin_destroy,
+    plugin_alloc,
+    plugin_free,
+    plugin_realloc,
+    plugin_stats,
+    plugin_aligned_alloc,
+    plugin_validate,
+};
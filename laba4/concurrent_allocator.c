@@ -0,0 +1,267 @@
+#include "concurrent_allocator.h"
+#include "allocator.h"
+#include "buddy_allocator.h"
+#include <stdint.h>
+#include <string.h>
+
+#define LARGE_CLASS ((size_t)-1)
+
+// Sits in front of every block handed out. Cached and remote-freed blocks
+// are chained through the first word of their payload.
+typedef struct CachedHeader {
+    ThreadCache* owner;
+    size_t size_class;
+} CachedHeader;
+
+static const size_t class_sizes[CONCURRENT_CLASS_COUNT] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024
+};
+
+static size_t class_for(size_t size) {
+    for (size_t i = 0; i < CONCURRENT_CLASS_COUNT; i++) {
+        if (size <= class_sizes[i]) return i;
+    }
+    return LARGE_CLASS;
+}
+
+static CachedHeader* header_of(void* memory) {
+    return (CachedHeader*)((char*)memory - sizeof(CachedHeader));
+}
+
+static void* next_of(void* memory) {
+    return *(void**)memory;
+}
+
+static void set_next(void* memory, void* next) {
+    *(void**)memory = next;
+}
+
+static void* arena_alloc(ConcurrentAllocator* allocator, size_t size) {
+    if (allocator->backend == CONCURRENT_BACKEND_BUDDY) {
+        return buddy_allocator_alloc(allocator->arena, size);
+    }
+    return allocator_alloc(allocator->arena, size);
+}
+
+static void arena_free(ConcurrentAllocator* allocator, void* memory) {
+    if (allocator->backend == CONCURRENT_BACKEND_BUDDY) {
+        buddy_allocator_free(allocator->arena, memory);
+    } else {
+        allocator_free(allocator->arena, memory);
+    }
+}
+
+// Returns a chain of payload pointers to the arena; the caller holds no lock.
+static void release_chain(ConcurrentAllocator* allocator, void* chain) {
+    if (!chain) return;
+
+    pthread_mutex_lock(&allocator->lock);
+    while (chain) {
+        void* next = next_of(chain);
+        arena_free(allocator, header_of(chain));
+        chain = next;
+    }
+    pthread_mutex_unlock(&allocator->lock);
+}
+
+static void release_remote(ThreadCache* cache) {
+    void* chain = __atomic_exchange_n(&cache->remote_free, NULL, __ATOMIC_SEQ_CST);
+    release_chain(cache->allocator, chain);
+}
+
+static void flush(ThreadCache* cache, CacheBin* bin) {
+    void* chain = NULL;
+    for (size_t i = 0; i < CONCURRENT_BATCH && bin->head; i++) {
+        void* block = bin->head;
+        bin->head = next_of(block);
+        bin->count--;
+        set_next(block, chain);
+        chain = block;
+    }
+    release_chain(cache->allocator, chain);
+}
+
+// Local frees and drained remote frees alike: a bin that outgrows
+// CONCURRENT_CACHE_LIMIT gives a batch back to the arena.
+static void cache_push(ThreadCache* cache, void* memory) {
+    CacheBin* bin = &cache->bins[header_of(memory)->size_class];
+    set_next(memory, bin->head);
+    bin->head = memory;
+    if (++bin->count > CONCURRENT_CACHE_LIMIT) flush(cache, bin);
+}
+
+static void cache_destructor(void* value) {
+    ThreadCache* cache = value;
+    ConcurrentAllocator* allocator = cache->allocator;
+
+    pthread_mutex_lock(&allocator->lock);
+    for (size_t i = 0; i < CONCURRENT_CLASS_COUNT; i++) {
+        void* block = cache->bins[i].head;
+        while (block) {
+            void* next = next_of(block);
+            arena_free(allocator, header_of(block));
+            block = next;
+        }
+        cache->bins[i].head = NULL;
+        cache->bins[i].count = 0;
+    }
+    pthread_mutex_unlock(&allocator->lock);
+
+    // Remote frees racing with the exit see `dead` and drain the stack
+    // themselves, whichever side exchanges a block out releases it.
+    __atomic_store_n(&cache->dead, 1, __ATOMIC_SEQ_CST);
+    release_remote(cache);
+
+    pthread_mutex_lock(&allocator->lock);
+    cache->next_cache = allocator->idle_caches;
+    allocator->idle_caches = cache;
+    pthread_mutex_unlock(&allocator->lock);
+}
+
+static ThreadCache* get_cache(ConcurrentAllocator* allocator) {
+    ThreadCache* cache = pthread_getspecific(allocator->cache_key);
+    if (cache) return cache;
+
+    // A parked cache is adopted as is: its bins are empty and blocks that
+    // still name it as owner simply come back to the new thread.
+    pthread_mutex_lock(&allocator->lock);
+    cache = allocator->idle_caches;
+    if (cache) {
+        allocator->idle_caches = cache->next_cache;
+        cache->next_cache = NULL;
+        __atomic_store_n(&cache->dead, 0, __ATOMIC_SEQ_CST);
+    } else {
+        char* raw = arena_alloc(allocator, sizeof(ThreadCache) + 64);
+        if (raw) {
+            cache = (ThreadCache*)(((uintptr_t)raw + 63) & ~(uintptr_t)63);
+            memset(cache, 0, sizeof(*cache));
+            cache->allocator = allocator;
+        }
+    }
+    pthread_mutex_unlock(&allocator->lock);
+
+    if (cache) pthread_setspecific(allocator->cache_key, cache);
+    return cache;
+}
+
+static void refill(ThreadCache* cache, size_t size_class) {
+    ConcurrentAllocator* allocator = cache->allocator;
+    CacheBin* bin = &cache->bins[size_class];
+    size_t block_size = sizeof(CachedHeader) + class_sizes[size_class];
+
+    // Blocks freed to us by other threads are reused before the arena.
+    void* chain = __atomic_exchange_n(&cache->remote_free, NULL, __ATOMIC_ACQUIRE);
+    while (chain) {
+        void* next = next_of(chain);
+        cache_push(cache, chain);
+        chain = next;
+    }
+    if (bin->head) return;
+
+    pthread_mutex_lock(&allocator->lock);
+    for (size_t i = 0; i < CONCURRENT_BATCH; i++) {
+        CachedHeader* header = arena_alloc(allocator, block_size);
+        if (!header) break;
+
+        header->owner = cache;
+        header->size_class = size_class;
+        void* memory = (char*)header + sizeof(CachedHeader);
+        set_next(memory, bin->head);
+        bin->head = memory;
+        bin->count++;
+    }
+    pthread_mutex_unlock(&allocator->lock);
+}
+
+ConcurrentAllocator* concurrent_allocator_create(void* memory, size_t size, ConcurrentBackend backend) {
+    size_t offset = (sizeof(ConcurrentAllocator) + 63) & ~(size_t)63;
+    if (!memory || size <= offset) return NULL;
+
+    ConcurrentAllocator* allocator = (ConcurrentAllocator*)memory;
+    allocator->backend = backend;
+    allocator->idle_caches = NULL;
+
+    if (backend == CONCURRENT_BACKEND_BUDDY) {
+        allocator->arena = buddy_allocator_create((char*)memory + offset, size - offset);
+    } else {
+        allocator->arena = allocator_create((char*)memory + offset, size - offset);
+    }
+    if (!allocator->arena) return NULL;
+
+    if (pthread_mutex_init(&allocator->lock, NULL) != 0) return NULL;
+    if (pthread_key_create(&allocator->cache_key, cache_destructor) != 0) {
+        pthread_mutex_destroy(&allocator->lock);
+        return NULL;
+    }
+
+    return allocator;
+}
+
+void concurrent_allocator_destroy(ConcurrentAllocator* allocator) {
+    if (!allocator) return;
+
+    pthread_key_delete(allocator->cache_key);
+    pthread_mutex_destroy(&allocator->lock);
+    if (allocator->backend == CONCURRENT_BACKEND_BUDDY) {
+        buddy_allocator_destroy(allocator->arena);
+    } else {
+        allocator_destroy(allocator->arena);
+    }
+}
+
+void* concurrent_allocator_alloc(ConcurrentAllocator* allocator, size_t size) {
+    if (size == 0) return NULL;
+
+    size_t size_class = class_for(size);
+    if (size_class == LARGE_CLASS) {
+        pthread_mutex_lock(&allocator->lock);
+        CachedHeader* header = arena_alloc(allocator, sizeof(CachedHeader) + size);
+        pthread_mutex_unlock(&allocator->lock);
+        if (!header) return NULL;
+
+        header->owner = NULL;
+        header->size_class = LARGE_CLASS;
+        return (char*)header + sizeof(CachedHeader);
+    }
+
+    ThreadCache* cache = get_cache(allocator);
+    if (!cache) return NULL;
+
+    CacheBin* bin = &cache->bins[size_class];
+    if (!bin->head) {
+        refill(cache, size_class);
+        if (!bin->head) return NULL;
+    }
+
+    void* memory = bin->head;
+    bin->head = next_of(memory);
+    bin->count--;
+    return memory;
+}
+
+void concurrent_allocator_free(ConcurrentAllocator* allocator, void* memory) {
+    if (!memory) return;
+
+    CachedHeader* header = header_of(memory);
+    ThreadCache* owner = header->owner;
+
+    if (!owner) {
+        pthread_mutex_lock(&allocator->lock);
+        arena_free(allocator, header);
+        pthread_mutex_unlock(&allocator->lock);
+        return;
+    }
+
+    if (owner == pthread_getspecific(allocator->cache_key)) {
+        cache_push(owner, memory);
+        return;
+    }
+
+    void* head = __atomic_load_n(&owner->remote_free, __ATOMIC_RELAXED);
+    do {
+        set_next(memory, head);
+    } while (!__atomic_compare_exchange_n(&owner->remote_free, &head, memory, 1,
+                                          __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+    if (__atomic_load_n(&owner->dead, __ATOMIC_SEQ_CST)) release_remote(owner);
+}
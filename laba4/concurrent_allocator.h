@@ -0,0 +1,49 @@
+#ifndef CONCURRENT_ALLOCATOR_H
+#define CONCURRENT_ALLOCATOR_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+#define CONCURRENT_CLASS_COUNT 12
+#define CONCURRENT_BATCH 32
+#define CONCURRENT_CACHE_LIMIT (4 * CONCURRENT_BATCH)
+
+typedef enum ConcurrentBackend {
+    CONCURRENT_BACKEND_FREE_LIST,
+    CONCURRENT_BACKEND_BUDDY
+} ConcurrentBackend;
+
+typedef struct CacheBin {
+    void* head;
+    size_t count;
+} CacheBin;
+
+// Per-thread cache of small blocks. Only the owning thread touches `bins`;
+// other threads hand blocks back through the lock-free `remote_free` stack.
+// When its thread exits the cache is emptied and parked for the next new
+// thread: blocks still in flight point at it, so it is never released.
+typedef struct ThreadCache {
+    struct ConcurrentAllocator* allocator;
+    struct ThreadCache* next_cache;
+    CacheBin bins[CONCURRENT_CLASS_COUNT];
+    _Alignas(64) void* remote_free;
+    int dead;
+} ThreadCache;
+
+// Front end over one shared Allocator or BuddyAllocator arena. The arena
+// is only touched under `lock`, and only to refill or flush a whole batch.
+// `idle_caches` holds the caches of exited threads, also under `lock`.
+typedef struct ConcurrentAllocator {
+    ConcurrentBackend backend;
+    void* arena;
+    pthread_mutex_t lock;
+    pthread_key_t cache_key;
+    ThreadCache* idle_caches;
+} ConcurrentAllocator;
+
+ConcurrentAllocator* concurrent_allocator_create(void* memory, size_t size, ConcurrentBackend backend);
+void concurrent_allocator_destroy(ConcurrentAllocator* allocator);
+void* concurrent_allocator_alloc(ConcurrentAllocator* allocator, size_t size);
+void concurrent_allocator_free(ConcurrentAllocator* allocator, void* memory);
+
+#endif // CONCURRENT_ALLOCATOR_H
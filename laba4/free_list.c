@@ -0,0 +1,308 @@
+#include "free_list.h"
+
+#define BLOCK_FREE ((uint64_t)1)
+#define MIN_BLOCK_SIZE sizeof(FreeListNode)
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static FreeListBlock* block_at(const char* base, FreeListLink link) {
+    return (FreeListBlock*)(base + link);
+}
+
+static FreeListNode* node_at(const char* base, FreeListLink link) {
+    return (FreeListNode*)(base + link);
+}
+
+static uint64_t block_size(const FreeListBlock* block) {
+    return block->size & ~BLOCK_FREE;
+}
+
+static int block_is_free(const FreeListBlock* block) {
+    return (int)(block->size & BLOCK_FREE);
+}
+
+static void set_size(char* base, FreeListLink block, uint64_t size, uint64_t flags) {
+    block_at(base, block)->size = size | flags;
+    block_at(base, block + size)->prev_size = size;
+}
+
+static uint64_t block_need(size_t size) {
+    uint64_t need = align_up(size, FREE_LIST_ALIGNMENT) + sizeof(FreeListBlock);
+    return need < MIN_BLOCK_SIZE ? MIN_BLOCK_SIZE : need;
+}
+
+static unsigned size_class(uint64_t size) {
+    if (size < FREE_LIST_SMALL_LIMIT) return (unsigned)(size / FREE_LIST_ALIGNMENT);
+
+    unsigned msb = 63 - (unsigned)__builtin_clzll(size);
+    unsigned half = (unsigned)(size >> (msb - 1)) & 1;
+    unsigned index = FREE_LIST_SMALL_CLASSES + (msb - 9) * 2 + half;
+    return index < FREE_LIST_CLASS_COUNT ? index : FREE_LIST_CLASS_COUNT - 1;
+}
+
+static void push_block(FreeListHeap* heap, char* base, FreeListLink link) {
+    FreeListNode* node = node_at(base, link);
+    unsigned index = size_class(block_size(&node->header));
+
+    node->prev = FREE_LIST_NULL;
+    node->next = heap->lists[index];
+    if (node->next) node_at(base, node->next)->prev = link;
+    heap->lists[index] = link;
+    heap->nonempty_classes |= 1ull << index;
+    heap->free_bytes += block_size(&node->header);
+}
+
+static void remove_block(FreeListHeap* heap, char* base, FreeListLink link) {
+    FreeListNode* node = node_at(base, link);
+    unsigned index = size_class(block_size(&node->header));
+
+    if (node->prev) {
+        node_at(base, node->prev)->next = node->next;
+    } else {
+        heap->lists[index] = node->next;
+    }
+    if (node->next) node_at(base, node->next)->prev = node->prev;
+
+    if (!heap->lists[index]) heap->nonempty_classes &= ~(1ull << index);
+    heap->free_bytes -= block_size(&node->header);
+}
+
+int free_list_init(FreeListHeap* heap, char* base, FreeListLink start, size_t size) {
+    // The last header is an allocated zero-size sentinel, so the final
+    // block always has a successor and never merges past the heap.
+    uint64_t usable = size & ~(uint64_t)(FREE_LIST_ALIGNMENT - 1);
+    if (usable < MIN_BLOCK_SIZE + sizeof(FreeListBlock)) return -1;
+    usable -= sizeof(FreeListBlock);
+
+    heap->start = start;
+    heap->size = usable;
+    heap->free_bytes = 0;
+    heap->nonempty_classes = 0;
+    for (unsigned i = 0; i < FREE_LIST_CLASS_COUNT; i++) {
+        heap->lists[i] = FREE_LIST_NULL;
+    }
+
+    block_at(base, start + usable)->size = 0;
+    block_at(base, start)->prev_size = 0;
+    set_size(base, start, usable, BLOCK_FREE);
+    push_block(heap, base, start);
+    return 0;
+}
+
+FreeListLink free_list_alloc(FreeListHeap* heap, char* base, size_t size, unsigned* class_index) {
+    if (size == 0 || size > heap->size) return FREE_LIST_NULL;
+
+    uint64_t need = block_need(size);
+    unsigned index = size_class(need);
+
+    // Exact classes: any block on the list fits. Range classes: blocks may
+    // be smaller than requested, first fit.
+    FreeListLink link = heap->lists[index];
+    if (index >= FREE_LIST_SMALL_CLASSES) {
+        while (link && block_size(block_at(base, link)) < need) link = node_at(base, link)->next;
+    }
+
+    if (!link && index + 1 < FREE_LIST_CLASS_COUNT) {
+        // Every block of a larger class fits, take the smallest such class.
+        uint64_t larger = heap->nonempty_classes & (~0ull << (index + 1));
+        if (!larger) return FREE_LIST_NULL;
+        link = heap->lists[__builtin_ctzll(larger)];
+    }
+    if (!link) return FREE_LIST_NULL;
+
+    remove_block(heap, base, link);
+
+    uint64_t available = block_size(block_at(base, link));
+    if (available - need >= MIN_BLOCK_SIZE) {
+        set_size(base, link, need, 0);
+        set_size(base, link + need, available - need, BLOCK_FREE);
+        push_block(heap, base, link + need);
+    } else {
+        set_size(base, link, available, 0);
+    }
+
+    if (class_index) *class_index = index;
+    return link + sizeof(FreeListBlock);
+}
+
+void free_list_free(FreeListHeap* heap, char* base, FreeListLink payload) {
+    if (!payload) return;
+
+    FreeListLink block = payload - sizeof(FreeListBlock);
+    uint64_t size = block_size(block_at(base, block));
+
+    FreeListLink next = block + size;
+    if (block_is_free(block_at(base, next))) {
+        size += block_size(block_at(base, next));
+        remove_block(heap, base, next);
+    }
+
+    uint64_t prev_size = block_at(base, block)->prev_size;
+    if (prev_size && block_is_free(block_at(base, block - prev_size))) {
+        block -= prev_size;
+        remove_block(heap, base, block);
+        size += prev_size;
+    }
+
+    set_size(base, block, size, BLOCK_FREE);
+    push_block(heap, base, block);
+}
+
+// Gives the part of an allocated block past `need` bytes back to the free
+// lists, merged with a free successor, if it is big enough to stand alone.
+static void release_tail(FreeListHeap* heap, char* base, FreeListLink block, uint64_t need) {
+    uint64_t size = block_size(block_at(base, block));
+    if (size - need < MIN_BLOCK_SIZE) return;
+
+    set_size(base, block, need, 0);
+    FreeListLink rest = block + need;
+    uint64_t rest_size = size - need;
+
+    FreeListLink next = rest + rest_size;
+    if (block_is_free(block_at(base, next))) {
+        remove_block(heap, base, next);
+        rest_size += block_size(block_at(base, next));
+    }
+
+    set_size(base, rest, rest_size, BLOCK_FREE);
+    push_block(heap, base, rest);
+}
+
+FreeListLink free_list_aligned_alloc(FreeListHeap* heap, char* base, size_t alignment, size_t size,
+                                     unsigned* class_index) {
+    if (alignment == 0 || (alignment & (alignment - 1))) return FREE_LIST_NULL;
+    if (alignment <= FREE_LIST_ALIGNMENT) return free_list_alloc(heap, base, size, class_index);
+    if (size == 0 || size + alignment + MIN_BLOCK_SIZE < size) return FREE_LIST_NULL;
+
+    // Over-allocate so an aligned payload exists at least MIN_BLOCK_SIZE
+    // past the start, the leading fragment then becomes a free block.
+    FreeListLink payload = free_list_alloc(heap, base, size + alignment + MIN_BLOCK_SIZE, class_index);
+    if (!payload) return FREE_LIST_NULL;
+
+    FreeListLink block = payload - sizeof(FreeListBlock);
+    uint64_t address = (uint64_t)(uintptr_t)(base + payload);
+    if (address & (alignment - 1)) {
+        uint64_t lead = align_up(address + MIN_BLOCK_SIZE, alignment) - address;
+        uint64_t total = block_size(block_at(base, block));
+
+        // The block came from the front of a free block, whose predecessor
+        // is allocated, so the fragment has no free neighbour to merge with.
+        set_size(base, block, lead, BLOCK_FREE);
+        push_block(heap, base, block);
+
+        block += lead;
+        set_size(base, block, total - lead, 0);
+        payload += lead;
+    }
+
+    release_tail(heap, base, block, block_need(size));
+    return payload;
+}
+
+int free_list_resize(FreeListHeap* heap, char* base, FreeListLink payload, size_t size) {
+    if (size > heap->size) return -1;
+
+    FreeListLink block = payload - sizeof(FreeListBlock);
+    uint64_t need = block_need(size);
+    uint64_t current = block_size(block_at(base, block));
+    if (need <= current) {
+        release_tail(heap, base, block, need);
+        return 0;
+    }
+
+    // Grow into a free successor when it brings enough space.
+    FreeListLink next = block + current;
+    uint64_t next_size = block_size(block_at(base, next));
+    if (!block_is_free(block_at(base, next)) || current + next_size < need) return -1;
+
+    remove_block(heap, base, next);
+    set_size(base, block, current + next_size, 0);
+    release_tail(heap, base, block, need);
+    return 0;
+}
+
+size_t free_list_usable_size(const char* base, FreeListLink payload) {
+    return block_size(block_at(base, payload - sizeof(FreeListBlock))) - sizeof(FreeListBlock);
+}
+
+size_t free_list_largest_free_block(const FreeListHeap* heap, const char* base) {
+    if (!heap->nonempty_classes) return 0;
+
+    // Only the highest non-empty class can hold the largest block.
+    unsigned index = 63 - (unsigned)__builtin_clzll(heap->nonempty_classes);
+    uint64_t largest = 0;
+    for (FreeListLink link = heap->lists[index]; link; link = node_at(base, link)->next) {
+        uint64_t size = block_size(block_at(base, link));
+        if (size > largest) largest = size;
+        if (index < FREE_LIST_SMALL_CLASSES) break;
+    }
+    return largest - sizeof(FreeListBlock);
+}
+
+double free_list_fragmentation(const FreeListHeap* heap, const char* base) {
+    if (heap->free_bytes == 0) return 0.0;
+
+    size_t largest = free_list_largest_free_block(heap, base) + sizeof(FreeListBlock);
+    return 1.0 - (double)largest / (double)heap->free_bytes;
+}
+
+void free_list_lengths(const FreeListHeap* heap, const char* base, size_t* lengths) {
+    for (unsigned i = 0; i < FREE_LIST_CLASS_COUNT; i++) {
+        size_t length = 0;
+        for (FreeListLink link = heap->lists[i]; link; link = node_at(base, link)->next) length++;
+        lengths[i] = length;
+    }
+}
+
+int free_list_validate(const FreeListHeap* heap, const char* base) {
+    FreeListLink start = heap->start;
+    FreeListLink end = start + heap->size;
+    if (end < start) return -1;
+
+    // Physical walk: sizes add up to the heap, boundary tags agree and no
+    // two free blocks are adjacent.
+    uint64_t free_blocks = 0;
+    uint64_t free_bytes = 0;
+    uint64_t prev_size = 0;
+    int prev_free = 0;
+    FreeListLink cursor = start;
+    while (cursor < end) {
+        const FreeListBlock* block = block_at(base, cursor);
+        uint64_t size = block_size(block);
+        if (size < MIN_BLOCK_SIZE || size % FREE_LIST_ALIGNMENT || size > end - cursor) return -1;
+        if (block->prev_size != prev_size) return -1;
+
+        if (block_is_free(block)) {
+            if (prev_free) return -1;
+            free_blocks++;
+            free_bytes += size;
+        }
+        prev_free = block_is_free(block);
+        prev_size = size;
+        cursor += size;
+    }
+
+    const FreeListBlock* sentinel = block_at(base, end);
+    if (cursor != end || sentinel->size != 0 || sentinel->prev_size != prev_size) return -1;
+    if (free_bytes != heap->free_bytes) return -1;
+
+    // Every listed block is free, inside the heap and in its own class;
+    // together the lists hold exactly the free blocks found above.
+    uint64_t listed = 0;
+    for (unsigned i = 0; i < FREE_LIST_CLASS_COUNT; i++) {
+        FreeListLink prev = FREE_LIST_NULL;
+        for (FreeListLink link = heap->lists[i]; link; link = node_at(base, link)->next) {
+            const FreeListNode* node = node_at(base, link);
+            if (link < start || link >= end || (link - start) % FREE_LIST_ALIGNMENT) return -1;
+            if (!block_is_free(&node->header)) return -1;
+            if (size_class(block_size(&node->header)) != i || node->prev != prev) return -1;
+            if (++listed > free_blocks) return -1;
+            prev = link;
+        }
+        if (((heap->nonempty_classes >> i) & 1) != (heap->lists[i] != FREE_LIST_NULL)) return -1;
+    }
+
+    return listed == free_blocks ? 0 : -1;
+}
@@ -0,0 +1,73 @@
+#ifndef FREE_LIST_H
+#define FREE_LIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Boundary-tag heap with segregated free lists, shared by the free-list
+// Allocator and the shared-memory ShmAllocator. Nothing in the heap holds
+// an address: blocks and list links are offsets from a `base` the owner
+// passes on every call (the Allocator itself, or the start of a shared
+// segment mapped at a different address in every process). Offset 0 is
+// the owner's header, so it doubles as the null link.
+//
+// Block sizes (header included) are multiples of FREE_LIST_ALIGNMENT.
+// Sizes below FREE_LIST_SMALL_LIMIT get one exact class per step, larger
+// sizes get two classes per power of two; the last class takes the rest.
+#define FREE_LIST_ALIGNMENT 16
+#define FREE_LIST_SMALL_LIMIT 512
+#define FREE_LIST_SMALL_CLASSES (FREE_LIST_SMALL_LIMIT / FREE_LIST_ALIGNMENT)
+#define FREE_LIST_CLASS_COUNT 64
+#define FREE_LIST_NULL ((FreeListLink)0)
+
+typedef uint64_t FreeListLink;
+
+// Boundary tag in front of every block. `prev_size` mirrors the size of
+// the physically preceding block (its footer), the low bit of `size`
+// marks the block itself as free.
+typedef struct FreeListBlock {
+    uint64_t prev_size;
+    uint64_t size;
+} FreeListBlock;
+
+typedef struct FreeListNode {
+    FreeListBlock header;
+    FreeListLink next;
+    FreeListLink prev;
+} FreeListNode;
+
+// `start` is the offset of the first block; the heap ends with an
+// allocated zero-size sentinel at start + size, so the last block never
+// merges past it.
+typedef struct FreeListHeap {
+    FreeListLink start;
+    uint64_t size;
+    uint64_t free_bytes;
+    uint64_t nonempty_classes;
+    FreeListLink lists[FREE_LIST_CLASS_COUNT];
+} FreeListHeap;
+
+// Formats `size` bytes at offset `start` (a multiple of the alignment
+// from an aligned address) as one free block. Returns -1 if too small.
+int free_list_init(FreeListHeap* heap, char* base, FreeListLink start, size_t size);
+
+// Payload offsets in, payload offsets out. `size_class` receives the
+// class the request was served from and may be NULL.
+FreeListLink free_list_alloc(FreeListHeap* heap, char* base, size_t size, unsigned* size_class);
+FreeListLink free_list_aligned_alloc(FreeListHeap* heap, char* base, size_t alignment, size_t size,
+                                     unsigned* size_class);
+void free_list_free(FreeListHeap* heap, char* base, FreeListLink payload);
+// Shrinks in place or grows into a free successor. Returns 0 when the
+// block now holds `size` bytes, -1 if it has to move.
+int free_list_resize(FreeListHeap* heap, char* base, FreeListLink payload, size_t size);
+size_t free_list_usable_size(const char* base, FreeListLink payload);
+
+size_t free_list_largest_free_block(const FreeListHeap* heap, const char* base);
+double free_list_fragmentation(const FreeListHeap* heap, const char* base);
+void free_list_lengths(const FreeListHeap* heap, const char* base, size_t* lengths);
+
+// Walks the whole heap and cross-checks boundary tags, free lists and
+// counters. Returns 0 if the heap is consistent, -1 otherwise.
+int free_list_validate(const FreeListHeap* heap, const char* base);
+
+#endif // FREE_LIST_H
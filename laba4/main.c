@@ -1,10 +1,8 @@
-#include "allocator.h"
-#include "buddy_allocator.h"
+#include "allocator_api.h"
 #include <stdio.h>
-#include <time.h>
 #include <dlfcn.h>
 
-#define MEMORY_SIZE (1 << MAX_BUDDY_ORDER)
+#define MEMORY_SIZE (1 << 20)
 char global_memory[MEMORY_SIZE];
 
 typedef struct Object {
@@ -13,138 +11,168 @@ typedef struct Object {
     float value;
 } Object;
 
-int main() {
-    void* allocator_lib = dlopen("./liballocator.so", RTLD_LAZY);
-    if (!allocator_lib) {
-        fprintf(stderr, "Ошибка загрузки библиотеки liballocator.so: %s\n", dlerror());
-        return 1;
-    }
+#define OBJECT_COUNT 3
+#define CHURN_BLOCKS 4096
 
-    void* buddy_lib = dlopen("./libbuddy_allocator.so", RTLD_LAZY);
-    if (!buddy_lib) {
-        fprintf(stderr, "Ошибка загрузки библиотеки libbuddy_allocator.so: %s\n", dlerror());
-        dlclose(allocator_lib);
-        return 1;
+static const float object_values[OBJECT_COUNT] = {123.45f, 678.90f, 135.79f};
+
+static const AllocatorApi* load_api(void* library, const char* path) {
+    const AllocatorApi* api = dlsym(library, ALLOCATOR_API_SYMBOL);
+    if (!api) {
+        fprintf(stderr, "Ошибка поиска %s в %s: %s\n", ALLOCATOR_API_SYMBOL, path, dlerror());
+        return NULL;
+    }
+    if (api->version != ALLOCATOR_API_VERSION || api->size < sizeof(AllocatorApi)) {
+        fprintf(stderr, "Несовместимая версия интерфейса в %s: %u\n", path, api->version);
+        return NULL;
     }
+    return api;
+}
 
-    struct timespec start, end;
+static void fill_object(Object* object, int id, const char* prefix, float value) {
+    if (!object) return;
 
-    printf("Тестирование аллокатора с обычным списком свободных блоков:\n");
+    object->id = id;
+    snprintf(object->name, sizeof(object->name), "%s %d", prefix, id);
+    object->value = value;
+}
 
-    Allocator* list_allocator = allocator_create(global_memory, MEMORY_SIZE);
-
-    clock_gettime(CLOCK_MONOTONIC, &start);
-    Object* object1 = allocator_alloc(list_allocator, sizeof(Object));
-    clock_gettime(CLOCK_MONOTONIC, &end);
-    double alloc_time1 = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
-    printf("Выделен блок: %p, время: %.9f секунд\n", object1, alloc_time1);
-
-    clock_gettime(CLOCK_MONOTONIC, &start);
-    Object* object2 = allocator_alloc(list_allocator, sizeof(Object));
-    clock_gettime(CLOCK_MONOTONIC, &end);
-    double alloc_time2 = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
-    printf("Выделен блок: %p, время: %.9f секунд\n", object2, alloc_time2);
-
-    clock_gettime(CLOCK_MONOTONIC, &start);
-    Object* object3 = allocator_alloc(list_allocator, sizeof(Object));
-    clock_gettime(CLOCK_MONOTONIC, &end);
-    double alloc_time3 = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
-    printf("Выделен блок: %p, время: %.9f секунд\n", object3, alloc_time3);
-
-    if (object1) {
-        object1->id = 1;
-        snprintf(object1->name, sizeof(object1->name), "Object 1");
-        object1->value = 123.45;
+// Printed before the block is freed: its contents are not ours afterwards.
+static void print_object(const Object* object) {
+    if (!object) return;
+
+    printf("Освобождается блок: %p (id=%d, name=%s, value=%.2f)\n",
+           (const void*)object, object->id, object->name, object->value);
+}
+
+static void test_objects(const AllocatorApi* api, const char* prefix) {
+    void* allocator = api->create(global_memory, MEMORY_SIZE);
+    if (!allocator) {
+        fprintf(stderr, "Не удалось создать аллокатор %s\n", api->name);
+        return;
     }
 
-    if (object2) {
-        object2->id = 2;
-        snprintf(object2->name, sizeof(object2->name), "Object 2");
-        object2->value = 678.90;
+    Object* objects[OBJECT_COUNT];
+    for (int i = 0; i < OBJECT_COUNT; i++) {
+        objects[i] = api->alloc(allocator, sizeof(Object));
+        printf("Выделен блок: %p\n", (void*)objects[i]);
+        fill_object(objects[i], i + 1, prefix, object_values[i]);
     }
 
-    if (object3) {
-        object3->id = 3;
-        snprintf(object3->name, sizeof(object3->name), "Object 3");
-        object3->value = 135.79;
+    for (int i = 0; i < OBJECT_COUNT; i++) {
+        print_object(objects[i]);
+        api->free(allocator, objects[i]);
+    }
+
+    api->destroy(allocator);
+}
+
+// Grows one buffer step by step and reports how often it stayed in place,
+// then requests a few over-aligned blocks.
+static void test_realloc(const AllocatorApi* api) {
+    void* allocator = api->create(global_memory, MEMORY_SIZE);
+    if (!allocator) return;
+
+    char* buffer = NULL;
+    int moves = 0;
+    int steps = 0;
+    for (size_t size = 64; size <= 16384; size += size / 2) {
+        char* grown = api->realloc(allocator, buffer, size);
+        if (!grown) break;
+        if (buffer && grown != buffer) moves++;
+        buffer = grown;
+        steps++;
+    }
+    printf("Буфер увеличен %d раз, из них с переносом: %d\n", steps, moves);
+    api->free(allocator, buffer);
+
+    for (size_t alignment = 64; alignment <= 4096; alignment *= 8) {
+        void* memory = api->aligned_alloc(allocator, alignment, 100);
+        printf("Выровненный блок (%zu): %p, остаток %zu\n", alignment, memory,
+               (size_t)memory % alignment);
+        api->free(allocator, memory);
     }
 
-    clock_gettime(CLOCK_MONOTONIC, &start);
-    allocator_free(list_allocator, object1);
-    clock_gettime(CLOCK_MONOTONIC, &end);
-    double free_time1 = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
-    printf("Освобождён блок: %p (id=%d, name=%s, value=%.2f), время: %.9f секунд\n", object1, object1->id, object1->name, object1->value, free_time1);
+    api->destroy(allocator);
+}
+
+static void print_fragmentation(const char* stage, const AllocatorApi* api, void* allocator) {
+    AllocatorApiStats stats;
+    api->stats(allocator, &stats);
 
-    clock_gettime(CLOCK_MONOTONIC, &start);
-    allocator_free(list_allocator, object2);
-    clock_gettime(CLOCK_MONOTONIC, &end);
-    double free_time2 = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
-    printf("Освобождён блок: %p (id=%d, name=%s, value=%.2f), время: %.9f секунд\n", object2, object2->id, object2->name, object2->value, free_time2);
+    printf("%s: свободно %zu байт, наибольший блок %zu байт, фрагментация %.3f\n",
+           stage, stats.free_bytes, stats.largest_free_block, stats.fragmentation);
+    printf("    занято %zu байт (пик %zu), выделений %zu, освобождений %zu, куча %s\n",
+           stats.live_bytes, stats.peak_bytes, stats.alloc_count, stats.free_count,
+           api->validate(allocator) == 0 ? "корректна" : "ПОВРЕЖДЕНА");
+}
 
-    clock_gettime(CLOCK_MONOTONIC, &start);
-    allocator_free(list_allocator, object3);
-    clock_gettime(CLOCK_MONOTONIC, &end);
-    double free_time3 = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
-    printf("Освобождён блок: %p (id=%d, name=%s, value=%.2f), время: %.9f секунд\n", object3, object3->id, object3->name, object3->value, free_time3);
+static void test_fragmentation(const AllocatorApi* api) {
+    static void* blocks[CHURN_BLOCKS];
 
-    printf("\nТестирование аллокатора с алгоритмом двойников:\n");
+    void* allocator = api->create(global_memory, MEMORY_SIZE);
+    if (!allocator) return;
+    print_fragmentation("Пустая арена", api, allocator);
 
-    BuddyAllocator* buddy_allocator = buddy_allocator_create(global_memory, MEMORY_SIZE);
-
-    clock_gettime(CLOCK_MONOTONIC, &start);
-    Object* buddy_object1 = buddy_allocator_alloc(buddy_allocator, sizeof(Object));
-    clock_gettime(CLOCK_MONOTONIC, &end);
-    double buddy_alloc_time1 = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
-    printf("Выделен блок: %p, время: %.9f секунд\n", buddy_object1, buddy_alloc_time1);
-
-    clock_gettime(CLOCK_MONOTONIC, &start);
-    Object* buddy_object2 = buddy_allocator_alloc(buddy_allocator, sizeof(Object));
-    clock_gettime(CLOCK_MONOTONIC, &end);
-    double buddy_alloc_time2 = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
-    printf("Выделен блок: %p, время: %.9f секунд\n", buddy_object2, buddy_alloc_time2);
-
-    clock_gettime(CLOCK_MONOTONIC, &start);
-    Object* buddy_object3 = buddy_allocator_alloc(buddy_allocator, sizeof(Object));
-    clock_gettime(CLOCK_MONOTONIC, &end);
-    double buddy_alloc_time3 = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
-    printf("Выделен блок: %p, время: %.9f секунд\n", buddy_object3, buddy_alloc_time3);
-
-    if (buddy_object1) {
-        buddy_object1->id = 1;
-        snprintf(buddy_object1->name, sizeof(buddy_object1->name), "Buddy Object 1");
-        buddy_object1->value = 123.45;
+    size_t count = 0;
+    while (count < CHURN_BLOCKS) {
+        blocks[count] = api->alloc(allocator, 64 + (count % 7) * 96);
+        if (!blocks[count]) break;
+        count++;
     }
 
-    if (buddy_object2) {
-        buddy_object2->id = 2;
-        snprintf(buddy_object2->name, sizeof(buddy_object2->name), "Buddy Object 2");
-        buddy_object2->value = 678.90;
+    for (size_t i = 0; i < count; i += 2) {
+        api->free(allocator, blocks[i]);
     }
+    print_fragmentation("Освобождён каждый второй блок", api, allocator);
 
-    if (buddy_object3) {
-        buddy_object3->id = 3;
-        snprintf(buddy_object3->name, sizeof(buddy_object3->name), "Buddy Object 3");
-        buddy_object3->value = 135.79;
+    for (size_t i = 1; i < count; i += 2) {
+        api->free(allocator, blocks[i]);
     }
+    print_fragmentation("Освобождены все блоки", api, allocator);
+
+    api->destroy(allocator);
+}
+
+int main() {
+    void* allocator_lib = dlopen("./liballocator_plugin.so", RTLD_LAZY);
+    if (!allocator_lib) {
+        fprintf(stderr, "Ошибка загрузки библиотеки liballocator_plugin.so: %s\n", dlerror());
+        return 1;
+    }
+
+    void* buddy_lib = dlopen("./libbuddy_allocator_plugin.so", RTLD_LAZY);
+    if (!buddy_lib) {
+        fprintf(stderr, "Ошибка загрузки библиотеки libbuddy_allocator_plugin.so: %s\n", dlerror());
+        dlclose(allocator_lib);
+        return 1;
+    }
+
+    const AllocatorApi* list_api = load_api(allocator_lib, "liballocator_plugin.so");
+    const AllocatorApi* buddy_api = load_api(buddy_lib, "libbuddy_allocator_plugin.so");
+    if (!list_api || !buddy_api) {
+        dlclose(allocator_lib);
+        dlclose(buddy_lib);
+        return 1;
+    }
+
+    printf("Тестирование аллокатора с обычным списком свободных блоков:\n");
+    test_objects(list_api, "Object");
+
+    printf("\nФрагментация аллокатора со списком свободных блоков:\n");
+    test_fragmentation(list_api);
+
+    printf("\nПерераспределение и выравнивание в аллокаторе со списком свободных блоков:\n");
+    test_realloc(list_api);
+
+    printf("\nТестирование аллокатора с алгоритмом двойников:\n");
+    test_objects(buddy_api, "Buddy Object");
+
+    printf("\nФрагментация аллокатора с алгоритмом двойников:\n");
+    test_fragmentation(buddy_api);
 
-    clock_gettime(CLOCK_MONOTONIC, &start);
-    buddy_allocator_free(buddy_allocator, buddy_object1);
-    clock_gettime(CLOCK_MONOTONIC, &end);
-    double buddy_free_time1 = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
-    printf("Освобождён блок: %p (id=%d, name=%s, value=%.2f), время: %.9f секунд\n", buddy_object1, buddy_object1->id, buddy_object1->name, buddy_object1->value, buddy_free_time1);
-
-    clock_gettime(CLOCK_MONOTONIC, &start);
-    buddy_allocator_free(buddy_allocator, buddy_object2);
-    clock_gettime(CLOCK_MONOTONIC, &end);
-    double buddy_free_time2 = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
-    printf("Освобождён блок: %p (id=%d, name=%s, value=%.2f), время: %.9f секунд\n", buddy_object2, buddy_object2->id, buddy_object2->name, buddy_object2->value, buddy_free_time2);
-
-    clock_gettime(CLOCK_MONOTONIC, &start);
-    buddy_allocator_free(buddy_allocator, buddy_object3);
-    clock_gettime(CLOCK_MONOTONIC, &end);
-    double buddy_free_time3 = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
-    printf("Освобождён блок: %p (id=%d, name=%s, value=%.2f), время: %.9f секунд\n", buddy_object3, buddy_object3->id, buddy_object3->name, buddy_object3->value, buddy_free_time3);
-    allocator_destroy(list_allocator);
+    printf("\nПерераспределение и выравнивание в аллокаторе с алгоритмом двойников:\n");
+    test_realloc(buddy_api);
 
     dlclose(allocator_lib);
     dlclose(buddy_lib);
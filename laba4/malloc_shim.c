@@ -0,0 +1,375 @@
+#define _GNU_SOURCE
+#include "allocator.h"
+#include "buddy_allocator.h"
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// LD_PRELOAD=./libmalloc_shim.so routes malloc and friends of an unmodified
+// program through one of the laba4 allocators:
+//   LABA4_ALLOCATOR   free-list (default) or buddy
+//   LABA4_ARENA_SIZE  arena size in bytes, default 256 MiB
+//   LABA4_TRACE       file to record an "a/f/r" trace for laba4_bench replay
+//   LABA4_STATS       file to append a stats line to every LABA4_STATS_EVERY
+//                     operations (default 100000) and at exit
+//   LABA4_VALIDATE    1 to run the heap validator for every stats line
+// Requests the arena cannot satisfy fall back to glibc.
+
+#define SHIM_EXPORT __attribute__((visibility("default")))
+#define DEFAULT_ARENA_SIZE ((size_t)256 << 20)
+#define DEFAULT_STATS_EVERY 100000
+
+extern void* __libc_malloc(size_t size);
+extern void __libc_free(void* memory);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* memory, size_t size);
+extern void* __libc_memalign(size_t alignment, size_t size);
+
+static pthread_mutex_t shim_lock = PTHREAD_MUTEX_INITIALIZER;
+static int shim_state;  // 0 - not started, 1 - starting, 2 - ready, 3 - disabled
+static int use_buddy;
+static void* arena;
+static char* arena_start;
+static char* arena_end;
+static int trace_fd = -1;
+static int stats_fd = -1;
+static size_t stats_every;
+static int stats_validate;
+static size_t operations;
+// glibc keeps no __libc_ alias for it; dlsym may allocate, so it is looked
+// up outside shim_lock.
+static size_t (*libc_usable_size)(void* memory);
+
+static size_t parse_size(const char* text, size_t fallback) {
+    if (!text || !*text) return fallback;
+
+    size_t value = 0;
+    for (; *text >= '0' && *text <= '9'; text++) {
+        value = value * 10 + (size_t)(*text - '0');
+    }
+    return value ? value : fallback;
+}
+
+// Called with shim_lock held; getenv, mmap and open do not allocate.
+static void shim_init(void) {
+    shim_state = 1;
+
+    const char* name = getenv("LABA4_ALLOCATOR");
+    use_buddy = name && strcmp(name, "buddy") == 0;
+
+    size_t size = parse_size(getenv("LABA4_ARENA_SIZE"), DEFAULT_ARENA_SIZE);
+    void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED) {
+        shim_state = 3;
+        return;
+    }
+
+    arena = use_buddy ? (void*)buddy_allocator_create(memory, size) : (void*)allocator_create(memory, size);
+    if (!arena) {
+        munmap(memory, size);
+        shim_state = 3;
+        return;
+    }
+    arena_start = memory;
+    arena_end = (char*)memory + size;
+
+    const char* trace = getenv("LABA4_TRACE");
+    if (trace && *trace) trace_fd = open(trace, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600);
+
+    const char* stats = getenv("LABA4_STATS");
+    if (stats && *stats) stats_fd = open(stats, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    stats_every = parse_size(getenv("LABA4_STATS_EVERY"), DEFAULT_STATS_EVERY);
+    const char* validate = getenv("LABA4_VALIDATE");
+    stats_validate = validate && strcmp(validate, "1") == 0;
+
+    __atomic_store_n(&shim_state, 2, __ATOMIC_RELEASE);
+}
+
+static void fork_prepare(void) {
+    pthread_mutex_lock(&shim_lock);
+}
+
+static void fork_release(void) {
+    pthread_mutex_unlock(&shim_lock);
+}
+
+static int shim_ready(void) {
+    int state = __atomic_load_n(&shim_state, __ATOMIC_ACQUIRE);
+    if (state >= 2) return state == 2;
+
+    int started = 0;
+    pthread_mutex_lock(&shim_lock);
+    if (shim_state == 0) {
+        shim_init();
+        started = 1;
+    }
+    state = shim_state;
+    pthread_mutex_unlock(&shim_lock);
+
+    // pthread_atfork and dlsym may allocate, so they run once the lock is
+    // released.
+    if (started) {
+        __atomic_store_n(&libc_usable_size, dlsym(RTLD_NEXT, "malloc_usable_size"), __ATOMIC_RELEASE);
+        if (state == 2) pthread_atfork(fork_prepare, fork_release, fork_release);
+    }
+    return state == 2;
+}
+
+static int owns(const void* memory) {
+    return (const char*)memory >= arena_start && (const char*)memory < arena_end;
+}
+
+// Formats "<op> 0x<id> [size]\n" by hand, stdio may allocate.
+static void trace_event(char op, const void* memory, size_t size) {
+    if (trace_fd == -1) return;
+
+    char line[64];
+    size_t pos = 0;
+    line[pos++] = op;
+    line[pos++] = ' ';
+    line[pos++] = '0';
+    line[pos++] = 'x';
+
+    char digits[32];
+    size_t count = 0;
+    uintptr_t value = (uintptr_t)memory;
+    do {
+        digits[count++] = "0123456789abcdef"[value & 15];
+        value >>= 4;
+    } while (value);
+    while (count) line[pos++] = digits[--count];
+
+    if (op != 'f') {
+        line[pos++] = ' ';
+        do {
+            digits[count++] = (char)('0' + size % 10);
+            size /= 10;
+        } while (size);
+        while (count) line[pos++] = digits[--count];
+    }
+    line[pos++] = '\n';
+
+    ssize_t written = write(trace_fd, line, pos);
+    (void)written;
+}
+
+// Appends " name=i:value,..." for the non-zero entries of `values`.
+static size_t format_counts(char* line, size_t pos, size_t size, const char* name, const size_t* values,
+                            size_t count) {
+    char separator = '=';
+    pos += (size_t)snprintf(line + pos, size - pos, " %s", name);
+    for (size_t i = 0; i < count && pos < size; i++) {
+        if (!values[i]) continue;
+        pos += (size_t)snprintf(line + pos, size - pos, "%c%zu:%zu", separator, i, values[i]);
+        separator = ',';
+    }
+    if (separator == '=' && pos < size) pos += (size_t)snprintf(line + pos, size - pos, "=");
+    return pos;
+}
+
+// Called with shim_lock held. Formats into a stack buffer: stdio streams
+// would allocate and come back into the shim.
+static void dump_stats(void) {
+    if (stats_fd == -1) return;
+
+    char line[2048];
+    size_t pos;
+    int valid;
+
+    if (use_buddy) {
+        BuddyStats stats;
+        buddy_allocator_stats(arena, &stats);
+        valid = stats_validate ? buddy_allocator_validate(arena) == 0 : -1;
+        pos = (size_t)snprintf(line, sizeof(line),
+                               "ops=%zu live=%zu peak=%zu free=%zu largest=%zu frag=%.3f allocs=%zu frees=%zu "
+                               "reallocs=%zu valid=%d",
+                               operations, stats.live_bytes, stats.peak_bytes, stats.free_bytes,
+                               stats.largest_free_block, stats.fragmentation, stats.alloc_count,
+                               stats.free_count, stats.realloc_count, valid);
+        pos = format_counts(line, pos, sizeof(line), "orders", stats.order_allocs, BUDDY_ORDER_COUNT);
+        pos = format_counts(line, pos, sizeof(line), "lists", stats.free_list_lengths, BUDDY_ORDER_COUNT);
+    } else {
+        AllocatorStats stats;
+        allocator_stats(arena, &stats);
+        valid = stats_validate ? allocator_validate(arena) == 0 : -1;
+        pos = (size_t)snprintf(line, sizeof(line),
+                               "ops=%zu live=%zu peak=%zu free=%zu largest=%zu frag=%.3f allocs=%zu frees=%zu "
+                               "reallocs=%zu valid=%d",
+                               operations, stats.live_bytes, stats.peak_bytes, stats.free_bytes,
+                               stats.largest_free_block, stats.fragmentation, stats.alloc_count,
+                               stats.free_count, stats.realloc_count, valid);
+        pos = format_counts(line, pos, sizeof(line), "classes", stats.class_allocs, ALLOCATOR_CLASS_COUNT);
+        pos = format_counts(line, pos, sizeof(line), "lists", stats.free_list_lengths, ALLOCATOR_CLASS_COUNT);
+    }
+
+    if (pos > sizeof(line) - 1) pos = sizeof(line) - 1;
+    line[pos++] = '\n';
+    ssize_t written = write(stats_fd, line, pos);
+    (void)written;
+}
+
+// Called with shim_lock held after every arena operation.
+static void count_operation(void) {
+    if (stats_fd != -1 && ++operations % stats_every == 0) dump_stats();
+}
+
+__attribute__((destructor)) static void shim_exit(void) {
+    if (__atomic_load_n(&shim_state, __ATOMIC_ACQUIRE) != 2) return;
+
+    pthread_mutex_lock(&shim_lock);
+    dump_stats();
+    pthread_mutex_unlock(&shim_lock);
+}
+
+static void* arena_alloc(size_t size) {
+    void* memory;
+    pthread_mutex_lock(&shim_lock);
+    memory = use_buddy ? buddy_allocator_alloc(arena, size) : allocator_alloc(arena, size);
+    if (memory) {
+        trace_event('a', memory, size);
+        count_operation();
+    }
+    pthread_mutex_unlock(&shim_lock);
+    return memory;
+}
+
+static size_t usable_size(void* memory) {
+    return use_buddy ? buddy_allocator_usable_size(arena, memory) : allocator_usable_size(arena, memory);
+}
+
+SHIM_EXPORT void* malloc(size_t size) {
+    if (size == 0) size = 1;
+    if (shim_ready()) {
+        void* memory = arena_alloc(size);
+        if (memory) return memory;
+    }
+    return __libc_malloc(size);
+}
+
+SHIM_EXPORT void free(void* memory) {
+    if (!memory) return;
+    if (!owns(memory)) {
+        __libc_free(memory);
+        return;
+    }
+
+    pthread_mutex_lock(&shim_lock);
+    trace_event('f', memory, 0);
+    if (use_buddy) {
+        buddy_allocator_free(arena, memory);
+    } else {
+        allocator_free(arena, memory);
+    }
+    count_operation();
+    pthread_mutex_unlock(&shim_lock);
+}
+
+SHIM_EXPORT void* calloc(size_t count, size_t size) {
+    size_t total;
+    if (__builtin_mul_overflow(count, size, &total)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if (shim_ready()) {
+        void* memory = arena_alloc(total ? total : 1);
+        if (memory) return memset(memory, 0, total);
+    }
+    return __libc_calloc(count, size);
+}
+
+SHIM_EXPORT void* realloc(void* memory, size_t size) {
+    if (!memory) return malloc(size);
+    if (size == 0) {
+        free(memory);
+        return NULL;
+    }
+    if (!owns(memory)) return __libc_realloc(memory, size);
+
+    // The trace keys blocks by address, so a move is a free plus an alloc.
+    pthread_mutex_lock(&shim_lock);
+    size_t old_size = usable_size(memory);
+    void* moved = use_buddy ? buddy_allocator_realloc(arena, memory, size)
+                            : allocator_realloc(arena, memory, size);
+    if (moved == memory) {
+        trace_event('r', memory, size);
+    } else if (moved) {
+        trace_event('f', memory, 0);
+        trace_event('a', moved, size);
+    }
+    count_operation();
+    pthread_mutex_unlock(&shim_lock);
+    if (moved) return moved;
+
+    // Arena exhausted: continue the block in glibc.
+    void* fallback = __libc_malloc(size);
+    if (!fallback) return NULL;
+    memcpy(fallback, memory, old_size < size ? old_size : size);
+    free(memory);
+    return fallback;
+}
+
+SHIM_EXPORT void* memalign(size_t alignment, size_t size) {
+    if (alignment <= ALLOCATOR_ALIGNMENT) return malloc(size);
+    if (alignment & (alignment - 1)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (size == 0) size = 1;
+
+    if (shim_ready()) {
+        pthread_mutex_lock(&shim_lock);
+        void* memory = use_buddy ? buddy_allocator_aligned_alloc(arena, alignment, size)
+                                 : allocator_aligned_alloc(arena, alignment, size);
+        if (memory) {
+            trace_event('a', memory, size);
+            count_operation();
+        }
+        pthread_mutex_unlock(&shim_lock);
+        if (memory) return memory;
+    }
+    return __libc_memalign(alignment, size);
+}
+
+SHIM_EXPORT int posix_memalign(void** out, size_t alignment, size_t size) {
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1))) return EINVAL;
+
+    void* memory = memalign(alignment, size);
+    if (!memory) return ENOMEM;
+    *out = memory;
+    return 0;
+}
+
+SHIM_EXPORT void* aligned_alloc(size_t alignment, size_t size) {
+    return memalign(alignment, size);
+}
+
+SHIM_EXPORT void* valloc(size_t size) {
+    return memalign((size_t)sysconf(_SC_PAGESIZE), size);
+}
+
+SHIM_EXPORT void* pvalloc(size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return memalign(page, (size + page - 1) & ~(page - 1));
+}
+
+SHIM_EXPORT size_t malloc_usable_size(void* memory) {
+    if (!memory) return 0;
+    if (owns(memory)) return usable_size(memory);
+
+    // Another thread may still be between init and the lookup.
+    shim_ready();
+    size_t (*next)(void*) = __atomic_load_n(&libc_usable_size, __ATOMIC_ACQUIRE);
+    if (!next) {
+        next = dlsym(RTLD_NEXT, "malloc_usable_size");
+        __atomic_store_n(&libc_usable_size, next, __ATOMIC_RELEASE);
+    }
+    return next ? next(memory) : 0;
+}
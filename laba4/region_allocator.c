@@ -0,0 +1,156 @@
+#include "region_allocator.h"
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define CHUNK_HEADER_SIZE align_up(sizeof(RegionChunk), REGION_ALIGNMENT)
+#define REGION_HEADER_SIZE align_up(sizeof(Region), REGION_ALIGNMENT)
+
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static RegionChunk* map_chunk(size_t size) {
+    RegionChunk* chunk = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (chunk == MAP_FAILED) return NULL;
+
+    chunk->next = NULL;
+    chunk->size = size;
+    return chunk;
+}
+
+// The first chunk also carries the Region header.
+static char* chunk_begin(const Region* region, RegionChunk* chunk) {
+    size_t header = chunk == region->first ? CHUNK_HEADER_SIZE + REGION_HEADER_SIZE : CHUNK_HEADER_SIZE;
+    return (char*)chunk + header;
+}
+
+static void enter_chunk(Region* region, RegionChunk* chunk, char* cursor) {
+    region->current = chunk;
+    region->cursor = cursor;
+    region->limit = (char*)chunk + chunk->size;
+}
+
+// Slow path: moves to the next retained chunk if the block fits there,
+// otherwise maps a chunk large enough and links it in after `current`.
+static void* grow(Region* region, size_t alignment, size_t size) {
+    size_t need = size + alignment - REGION_ALIGNMENT;
+    RegionChunk* chunk = region->current->next;
+
+    if (!chunk || chunk->size - CHUNK_HEADER_SIZE < need) {
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        size_t chunk_size = align_up(CHUNK_HEADER_SIZE + need, page);
+        if (chunk_size < region->chunk_size) chunk_size = region->chunk_size;
+
+        RegionChunk* fresh = map_chunk(chunk_size);
+        if (!fresh) return NULL;
+
+        fresh->next = chunk;
+        region->current->next = fresh;
+        region->chunk_count++;
+        region->mapped_bytes += chunk_size;
+        chunk = fresh;
+    }
+
+    enter_chunk(region, chunk, chunk_begin(region, chunk));
+    char* memory = (char*)align_up((uintptr_t)region->cursor, alignment);
+    region->cursor = memory + size;
+    return memory;
+}
+
+Region* region_create(size_t chunk_size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    if (chunk_size == 0) chunk_size = REGION_DEFAULT_CHUNK_SIZE;
+    chunk_size = align_up(chunk_size, page);
+    if (chunk_size < CHUNK_HEADER_SIZE + REGION_HEADER_SIZE + REGION_ALIGNMENT) chunk_size += page;
+
+    RegionChunk* chunk = map_chunk(chunk_size);
+    if (!chunk) return NULL;
+
+    Region* region = (Region*)((char*)chunk + CHUNK_HEADER_SIZE);
+    region->first = chunk;
+    region->chunk_size = chunk_size;
+    region->chunk_count = 1;
+    region->mapped_bytes = chunk_size;
+    enter_chunk(region, chunk, chunk_begin(region, chunk));
+    return region;
+}
+
+void region_destroy(Region* region) {
+    if (!region) return;
+
+    RegionChunk* first = region->first;
+    RegionChunk* chunk = first->next;
+    while (chunk) {
+        RegionChunk* next = chunk->next;
+        munmap(chunk, chunk->size);
+        chunk = next;
+    }
+    munmap(first, first->size);
+}
+
+void* region_alloc(Region* region, size_t size) {
+    if (size == 0 || size > SIZE_MAX / 2) return NULL;
+
+    size = align_up(size, REGION_ALIGNMENT);
+    if (size > (size_t)(region->limit - region->cursor)) return grow(region, REGION_ALIGNMENT, size);
+
+    char* memory = region->cursor;
+    region->cursor += size;
+    return memory;
+}
+
+void* region_aligned_alloc(Region* region, size_t alignment, size_t size) {
+    if (size == 0 || size > SIZE_MAX / 2) return NULL;
+    if (alignment & (alignment - 1)) return NULL;
+    if (alignment < REGION_ALIGNMENT) alignment = REGION_ALIGNMENT;
+    if (alignment > SIZE_MAX / 4) return NULL;
+
+    size = align_up(size, REGION_ALIGNMENT);
+    char* memory = (char*)align_up((uintptr_t)region->cursor, alignment);
+    if (memory > region->limit || size > (size_t)(region->limit - memory)) {
+        return grow(region, alignment, size);
+    }
+
+    region->cursor = memory + size;
+    return memory;
+}
+
+RegionMark region_mark(const Region* region) {
+    return (RegionMark){region->current, region->cursor};
+}
+
+void region_rewind(Region* region, RegionMark mark) {
+    enter_chunk(region, mark.chunk, mark.cursor);
+}
+
+void region_reset(Region* region) {
+    enter_chunk(region, region->first, chunk_begin(region, region->first));
+}
+
+void region_trim(Region* region) {
+    RegionChunk* chunk = region->current->next;
+    region->current->next = NULL;
+
+    while (chunk) {
+        RegionChunk* next = chunk->next;
+        region->chunk_count--;
+        region->mapped_bytes -= chunk->size;
+        munmap(chunk, chunk->size);
+        chunk = next;
+    }
+}
+
+// Counts the unused tails of filled chunks as well: they are lost until
+// the region is rewound past them.
+size_t region_used_bytes(const Region* region) {
+    size_t used = 0;
+    for (RegionChunk* chunk = region->first; chunk != region->current; chunk = chunk->next) {
+        used += (size_t)((char*)chunk + chunk->size - chunk_begin(region, chunk));
+    }
+    return used + (size_t)(region->cursor - chunk_begin(region, region->current));
+}
+
+size_t region_mapped_bytes(const Region* region) {
+    return region->mapped_bytes;
+}
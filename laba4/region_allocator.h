@@ -0,0 +1,53 @@
+#ifndef REGION_ALLOCATOR_H
+#define REGION_ALLOCATOR_H
+
+#include <stddef.h>
+
+#define REGION_ALIGNMENT 16
+#define REGION_DEFAULT_CHUNK_SIZE ((size_t)64 << 10)
+
+// mmap'd chunk of a region, its payload follows the header. Chunks form
+// one list: the ones up to `current` hold data, the ones after it are
+// kept from earlier batches and reused before anything new is mapped.
+typedef struct RegionChunk {
+    struct RegionChunk* next;
+    size_t size;
+} RegionChunk;
+
+// Bump allocator for data that dies all at once. The Region lives at the
+// start of its first chunk, which is never unmapped before destroy.
+typedef struct Region {
+    RegionChunk* first;
+    RegionChunk* current;
+    char* cursor;
+    char* limit;
+    size_t chunk_size;
+    size_t chunk_count;
+    size_t mapped_bytes;
+} Region;
+
+// Position to rewind to. Marks nest like a stack: rewinding to a mark
+// invalidates every mark taken after it.
+typedef struct RegionMark {
+    RegionChunk* chunk;
+    char* cursor;
+} RegionMark;
+
+// `chunk_size` 0 means REGION_DEFAULT_CHUNK_SIZE.
+Region* region_create(size_t chunk_size);
+void region_destroy(Region* region);
+
+void* region_alloc(Region* region, size_t size);
+void* region_aligned_alloc(Region* region, size_t alignment, size_t size);
+
+RegionMark region_mark(const Region* region);
+void region_rewind(Region* region, RegionMark mark);
+// Drops everything allocated, chunks stay mapped for the next batch.
+void region_reset(Region* region);
+// Unmaps the chunks past the one in use.
+void region_trim(Region* region);
+
+size_t region_used_bytes(const Region* region);
+size_t region_mapped_bytes(const Region* region);
+
+#endif // REGION_ALLOCATOR_H
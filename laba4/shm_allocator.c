@@ -0,0 +1,132 @@
+#include "shm_allocator.h"
+#include <errno.h>
+
+// The part of the segment every process interprets the same way.
+_Static_assert(sizeof(FreeListHeap) == (4 + FREE_LIST_CLASS_COUNT) * sizeof(uint64_t),
+               "free-list heap must have a fixed layout");
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static char* base_of(const ShmAllocator* allocator) {
+    return (char*)allocator;
+}
+
+// Bounds are checked first: a torn header must not send the walk outside
+// the segment.
+static int heap_intact(const ShmAllocator* allocator) {
+    const FreeListHeap* heap = &allocator->heap;
+    if (heap->start < sizeof(ShmAllocator) || heap->start > allocator->segment_size - sizeof(FreeListBlock)) return 0;
+    if (heap->size > allocator->segment_size - heap->start - sizeof(FreeListBlock)) return 0;
+    return free_list_validate(heap, base_of(allocator)) == 0;
+}
+
+static int lock(ShmAllocator* allocator) {
+    int result = pthread_mutex_lock(&allocator->lock);
+    if (result == EOWNERDEAD) {
+        // The previous owner died inside a critical section. Unlocking
+        // without marking the mutex consistent makes it ENOTRECOVERABLE
+        // for every process, which is what a broken heap deserves.
+        if (heap_intact(allocator)) {
+            pthread_mutex_consistent(&allocator->lock);
+            return 0;
+        }
+        pthread_mutex_unlock(&allocator->lock);
+        result = ENOTRECOVERABLE;
+    }
+    if (result != 0) {
+        errno = result;
+        return -1;
+    }
+    return 0;
+}
+
+static void unlock(ShmAllocator* allocator) {
+    pthread_mutex_unlock(&allocator->lock);
+}
+
+ShmAllocator* shm_allocator_create(void* memory, size_t size) {
+    if (!memory || size < sizeof(ShmAllocator)) return NULL;
+
+    // mmap returns page-aligned memory, so aligned offsets are aligned
+    // addresses in every process.
+    uint64_t start = align_up(sizeof(ShmAllocator), FREE_LIST_ALIGNMENT);
+    if (start >= size) return NULL;
+
+    ShmAllocator* allocator = memory;
+    if (free_list_init(&allocator->heap, base_of(allocator), start, size - start) != 0) return NULL;
+
+    pthread_mutexattr_t attributes;
+    if (pthread_mutexattr_init(&attributes) != 0) return NULL;
+    pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+    int failed = pthread_mutex_init(&allocator->lock, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+    if (failed) return NULL;
+
+    allocator->segment_size = size;
+    allocator->header_size = sizeof(ShmAllocator);
+    allocator->root = SHM_NULL;
+
+    // Published last: attach refuses the segment until it is complete.
+    __atomic_store_n(&allocator->magic, SHM_ALLOCATOR_MAGIC, __ATOMIC_RELEASE);
+    return allocator;
+}
+
+ShmAllocator* shm_allocator_attach(void* memory, size_t size) {
+    if (!memory || size < sizeof(ShmAllocator)) return NULL;
+
+    ShmAllocator* allocator = memory;
+    if (__atomic_load_n(&allocator->magic, __ATOMIC_ACQUIRE) != SHM_ALLOCATOR_MAGIC) return NULL;
+    if (allocator->segment_size != size || allocator->header_size != sizeof(ShmAllocator)) return NULL;
+    return allocator;
+}
+
+void shm_allocator_destroy(ShmAllocator* allocator) {
+    if (!allocator) return;
+
+    allocator->magic = 0;
+    pthread_mutex_destroy(&allocator->lock);
+}
+
+ShmOffset shm_allocator_alloc(ShmAllocator* allocator, size_t size) {
+    if (lock(allocator) != 0) return SHM_NULL;
+    ShmOffset offset = free_list_alloc(&allocator->heap, base_of(allocator), size, NULL);
+    unlock(allocator);
+
+    if (!offset) errno = ENOMEM;
+    return offset;
+}
+
+int shm_allocator_free(ShmAllocator* allocator, ShmOffset offset) {
+    if (!offset) return 0;
+
+    if (lock(allocator) != 0) return -1;
+    free_list_free(&allocator->heap, base_of(allocator), offset);
+    unlock(allocator);
+    return 0;
+}
+
+void* shm_allocator_ptr(const ShmAllocator* allocator, ShmOffset offset) {
+    return offset ? base_of(allocator) + offset : NULL;
+}
+
+ShmOffset shm_allocator_offset(const ShmAllocator* allocator, const void* memory) {
+    return memory ? (ShmOffset)((const char*)memory - (const char*)allocator) : SHM_NULL;
+}
+
+void shm_allocator_set_root(ShmAllocator* allocator, ShmOffset root) {
+    __atomic_store_n(&allocator->root, root, __ATOMIC_RELEASE);
+}
+
+ShmOffset shm_allocator_root(const ShmAllocator* allocator) {
+    return __atomic_load_n(&allocator->root, __ATOMIC_ACQUIRE);
+}
+
+size_t shm_allocator_free_bytes(ShmAllocator* allocator) {
+    if (lock(allocator) != 0) return 0;
+    size_t free_bytes = allocator->heap.free_bytes;
+    unlock(allocator);
+    return free_bytes;
+}
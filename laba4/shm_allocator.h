@@ -0,0 +1,57 @@
+#ifndef SHM_ALLOCATOR_H
+#define SHM_ALLOCATOR_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "free_list.h"
+
+// Free-list allocator for a segment shared between processes that may map
+// it at different addresses. Nothing inside the segment holds a pointer:
+// blocks and list links are offsets from the start of the segment, where
+// the ShmAllocator itself lives. Offset 0 is that header, so it doubles as
+// the null offset. The heap itself is the shared free-list core.
+#define SHM_ALLOCATOR_MAGIC 0x4c41423453484d41ull
+#define SHM_NULL FREE_LIST_NULL
+
+typedef FreeListLink ShmOffset;
+
+// `lock` is a robust process-shared mutex: if a process dies holding it
+// the next locker takes the segment over only if the heap still
+// validates, otherwise the segment becomes unusable. `root` is a free slot
+// for the creator to publish the offset of its top-level structure to
+// processes attaching.
+//
+// The heap has fixed-width fields, but pthread_mutex_t is ABI-specific,
+// so only processes of the same ABI can share a segment; attach rejects a
+// header of another size.
+typedef struct ShmAllocator {
+    uint64_t magic;
+    uint64_t segment_size;
+    uint64_t header_size;
+    pthread_mutex_t lock;
+    ShmOffset root;
+    FreeListHeap heap;
+} ShmAllocator;
+
+// Formats `memory` (the start of the mapping) as a new segment.
+ShmAllocator* shm_allocator_create(void* memory, size_t size);
+// Checks a segment created by another process and mapped at `memory`.
+ShmAllocator* shm_allocator_attach(void* memory, size_t size);
+void shm_allocator_destroy(ShmAllocator* allocator);
+
+// Both fail with errno ENOTRECOVERABLE once a process died holding the
+// lock and left the heap inconsistent; alloc sets ENOMEM when nothing fits.
+ShmOffset shm_allocator_alloc(ShmAllocator* allocator, size_t size);
+int shm_allocator_free(ShmAllocator* allocator, ShmOffset offset);
+
+void* shm_allocator_ptr(const ShmAllocator* allocator, ShmOffset offset);
+ShmOffset shm_allocator_offset(const ShmAllocator* allocator, const void* memory);
+
+void shm_allocator_set_root(ShmAllocator* allocator, ShmOffset root);
+ShmOffset shm_allocator_root(const ShmAllocator* allocator);
+// 0 for an unusable segment.
+size_t shm_allocator_free_bytes(ShmAllocator* allocator);
+
+#endif // SHM_ALLOCATOR_H
@@ -0,0 +1,173 @@
+#include "slab_allocator.h"
+#include <stdint.h>
+
+#define SLAB_HEADER_SIZE SLAB_CACHE_LINE
+
+_Static_assert(sizeof(Slab) <= SLAB_HEADER_SIZE, "slab header must fit one cache line");
+
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static Slab* slab_of(const SlabCache* cache, void* memory) {
+    char* start = cache->owner->memory_start;
+    size_t offset = (size_t)((char*)memory - start);
+    return (Slab*)(start + (offset & ~(size_t)(SLAB_SIZE - 1)));
+}
+
+static void list_push(Slab** list, Slab* slab) {
+    slab->prev = NULL;
+    slab->next = *list;
+    if (*list) (*list)->prev = slab;
+    *list = slab;
+}
+
+static void list_remove(Slab** list, Slab* slab) {
+    if (slab->prev) {
+        slab->prev->next = slab->next;
+    } else {
+        *list = slab->next;
+    }
+    if (slab->next) slab->next->prev = slab->prev;
+}
+
+static Slab* take_slab(SlabCache* cache) {
+    SlabAllocator* allocator = cache->owner;
+    Slab* slab;
+
+    if (allocator->free_slabs) {
+        slab = allocator->free_slabs;
+        allocator->free_slabs = slab->next;
+    } else if (allocator->slabs_used < allocator->slab_count) {
+        slab = (Slab*)(allocator->memory_start + allocator->slabs_used * SLAB_SIZE);
+    } else {
+        return NULL;
+    }
+    allocator->slabs_used++;
+
+    size_t colour = cache->next_colour;
+    cache->next_colour = (cache->next_colour + 1) % cache->colours;
+
+    slab->cache = cache;
+    slab->free_list = NULL;
+    slab->objects = (char*)slab + SLAB_HEADER_SIZE + colour * SLAB_CACHE_LINE;
+    slab->in_use = 0;
+    slab->fresh = 0;
+    return slab;
+}
+
+static void release_slab(SlabCache* cache, Slab* slab) {
+    SlabAllocator* allocator = cache->owner;
+    slab->cache = NULL;
+    slab->next = allocator->free_slabs;
+    allocator->free_slabs = slab;
+    allocator->slabs_used--;
+}
+
+SlabAllocator* slab_allocator_create(void* memory, size_t size) {
+    if (!memory || size < sizeof(SlabAllocator)) return NULL;
+
+    size_t start = align_up((size_t)memory + sizeof(SlabAllocator), SLAB_SIZE);
+    size_t end = (size_t)memory + size;
+    if (start >= end || end - start < SLAB_SIZE) return NULL;
+
+    SlabAllocator* allocator = (SlabAllocator*)memory;
+    allocator->memory_start = (char*)start;
+    allocator->slab_count = (end - start) / SLAB_SIZE;
+    allocator->slabs_used = 0;
+    allocator->free_slabs = NULL;
+    allocator->cache_count = 0;
+
+    return allocator;
+}
+
+void slab_allocator_destroy(SlabAllocator* allocator) {
+    (void)allocator;
+}
+
+SlabCache* slab_cache_create(SlabAllocator* allocator, size_t object_size) {
+    if (object_size == 0 || allocator->cache_count == MAX_SLAB_CACHES) return NULL;
+
+    // Small objects get a stride dividing the cache line, larger ones a
+    // whole number of cache lines, so each object touches as few as possible.
+    size_t stride = align_up(object_size < sizeof(void*) ? sizeof(void*) : object_size, sizeof(void*));
+    if (stride <= SLAB_CACHE_LINE) {
+        while (SLAB_CACHE_LINE % stride) stride += sizeof(void*);
+    } else {
+        stride = align_up(stride, SLAB_CACHE_LINE);
+    }
+
+    size_t space = SLAB_SIZE - SLAB_HEADER_SIZE;
+    if (stride > space) return NULL;
+
+    SlabCache* cache = &allocator->caches[allocator->cache_count++];
+    cache->owner = allocator;
+    cache->object_size = object_size;
+    cache->stride = stride;
+    cache->objects_per_slab = space / stride;
+    cache->colours = (space - cache->objects_per_slab * stride) / SLAB_CACHE_LINE + 1;
+    cache->next_colour = 0;
+    cache->partial = NULL;
+    cache->full = NULL;
+    cache->empty = NULL;
+
+    return cache;
+}
+
+void* slab_cache_alloc(SlabCache* cache) {
+    Slab* slab = cache->partial;
+    if (!slab) {
+        if (cache->empty) {
+            slab = cache->empty;
+            list_remove(&cache->empty, slab);
+        } else {
+            slab = take_slab(cache);
+            if (!slab) return NULL;
+        }
+        list_push(&cache->partial, slab);
+    }
+
+    // Recycled objects first, then never-touched ones, so a new slab is
+    // ready without threading a free list through all of it.
+    void* memory;
+    if (slab->free_list) {
+        memory = slab->free_list;
+        slab->free_list = *(void**)memory;
+    } else {
+        memory = slab->objects + slab->fresh * cache->stride;
+        slab->fresh++;
+    }
+
+    if (++slab->in_use == cache->objects_per_slab) {
+        list_remove(&cache->partial, slab);
+        list_push(&cache->full, slab);
+    }
+    return memory;
+}
+
+void slab_cache_free(SlabCache* cache, void* memory) {
+    if (!memory) return;
+
+    Slab* slab = slab_of(cache, memory);
+    *(void**)memory = slab->free_list;
+    slab->free_list = memory;
+
+    if (slab->in_use-- == cache->objects_per_slab) {
+        list_remove(&cache->full, slab);
+        list_push(&cache->partial, slab);
+    }
+
+    if (slab->in_use == 0) {
+        list_remove(&cache->partial, slab);
+        // Keep one empty slab per cache to absorb alloc/free ping-pong.
+        if (cache->empty) {
+            release_slab(cache, slab);
+        } else {
+            list_push(&cache->empty, slab);
+        }
+    }
+}
+
+size_t slab_allocator_free_bytes(const SlabAllocator* allocator) {
+    return (allocator->slab_count - allocator->slabs_used) * SLAB_SIZE;
+}
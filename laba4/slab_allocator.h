@@ -0,0 +1,55 @@
+#ifndef SLAB_ALLOCATOR_H
+#define SLAB_ALLOCATOR_H
+
+#include <stddef.h>
+
+#define SLAB_SIZE 4096
+#define SLAB_CACHE_LINE 64
+#define MAX_SLAB_CACHES 16
+
+// Lives in the first cache line of every slab. Objects carry no header:
+// the owning slab is found by rounding the object address down to
+// SLAB_SIZE, and free objects are chained through their first word.
+typedef struct Slab {
+    struct SlabCache* cache;
+    struct Slab* next;
+    struct Slab* prev;
+    void* free_list;
+    char* objects;
+    size_t in_use;
+    size_t fresh;
+} Slab;
+
+// Per-type cache. `stride` is the object size rounded so that no object
+// straddles more cache lines than it has to, successive slabs shift their
+// first object by `colour` cache lines to spread hot objects over sets.
+typedef struct SlabCache {
+    struct SlabAllocator* owner;
+    size_t object_size;
+    size_t stride;
+    size_t objects_per_slab;
+    size_t colours;
+    size_t next_colour;
+    Slab* partial;
+    Slab* full;
+    Slab* empty;
+} SlabCache;
+
+typedef struct SlabAllocator {
+    char* memory_start;
+    size_t slab_count;
+    size_t slabs_used;
+    Slab* free_slabs;
+    SlabCache caches[MAX_SLAB_CACHES];
+    size_t cache_count;
+} SlabAllocator;
+
+SlabAllocator* slab_allocator_create(void* memory, size_t size);
+void slab_allocator_destroy(SlabAllocator* allocator);
+SlabCache* slab_cache_create(SlabAllocator* allocator, size_t object_size);
+void* slab_cache_alloc(SlabCache* cache);
+void slab_cache_free(SlabCache* cache, void* memory);
+
+size_t slab_allocator_free_bytes(const SlabAllocator* allocator);
+
+#endif // SLAB_ALLOCATOR_H